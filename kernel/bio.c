@@ -22,6 +22,7 @@
 #include "defs.h"
 #include "fs.h"
 #include "buf.h"
+#include "blk.h"
 
 struct {
   struct spinlock lock; //该自旋锁保护哪些块已经被缓存的信息
@@ -47,6 +48,7 @@ binit(void)
   bcache.head.next = &bcache.head;
   //构建缓存区链表，不断往head节点后插入b
   for(b = bcache.buf; b < bcache.buf+NBUF; b++){
+    b->id = b - bcache.buf;
     b->next = bcache.head.next;
     b->prev = &bcache.head;
     initsleeplock(&b->lock, "buffer");
@@ -103,12 +105,29 @@ bread(uint dev, uint blockno)
   //若缓存区不包含块的副本，则从磁盘读取到缓存区上
   if(!b->valid) {
     //virtio_disk_rw(b, 0); //0表示读取磁盘
-    rw_queue(b,0);
+    if(blk_zeroing(blockno))
+      memset(b->data, 0, BSIZE); //待设备清零的新块，已知为全零，无需读盘
+    else
+      rw_queue(b,REQ_POLL);  //有人在等这次读，可轮询
     b->valid = 1; //缓存区已经包含块的副本
   }
   return b;
 }
 
+// Return a locked buf for the indicated block, to be
+// overwritten entirely: its contents are zeroed here
+// instead of read from disk.
+struct buf*
+bgetzero(uint dev, uint blockno)
+{
+  struct buf *b;
+
+  b = bget(dev, blockno);
+  memset(b->data, 0, BSIZE);
+  b->valid = 1;
+  return b;
+}
+
 // Write b's contents to disk.  Must be locked.
 void
 bwrite(struct buf *b)
@@ -116,7 +135,46 @@ bwrite(struct buf *b)
   if(!holdingsleep(&b->lock)) //要保证持有该缓存块的睡眠锁
     panic("bwrite");
   //virtio_disk_rw(b, 1); //1表示写入磁盘块
-  rw_queue(b,1);
+  rw_queue(b,REQ_WRITE);
+}
+
+// Write b's contents to disk as a synchronous write: someone
+// is waiting on it to finish a commit. Must be locked.
+void
+bwrite_sync(struct buf *b)
+{
+  if(!holdingsleep(&b->lock))
+    panic("bwrite_sync");
+  rw_queue(b,REQ_WRITE|REQ_SYNC);
+}
+
+// Start writing b's contents to disk and return at once, so
+// that several writes can go to the disk together; sync as for
+// bwrite_sync(). The caller must bwait(b) before letting go of
+// it. Must be locked.
+void
+bwrite_async(struct buf *b, int sync)
+{
+  if(!holdingsleep(&b->lock))
+    panic("bwrite_async");
+  rw_submit(b, sync ? REQ_WRITE|REQ_SYNC : REQ_WRITE);
+}
+
+// Wait for a bwrite_async() of b to finish.
+void
+bwait(struct buf *b)
+{
+  if(!holdingsleep(&b->lock))
+    panic("bwait");
+  rw_wait(b);
+}
+
+// Make every write that has finished so far durable, for
+// a disk with a write-back cache.
+void
+bflush(void)
+{
+  rw_flush();
 }
 
 // Release a locked buffer.
@@ -0,0 +1,994 @@
+//
+// block request layer.
+//
+// block requests flow through four stages:
+//   rw_queue()          fills in the buf's own struct req, puts it
+//                       on the current hart's staging list, and
+//                       sleeps until its buf is done. rw_submit()
+//                       and rw_wait() do the two halves separately,
+//                       so a caller can stage many bufs and have
+//                       them reach the device together.
+//   blk_flush()         moves the staged requests of every hart to
+//                       the current elevator in one batch; it may
+//                       merge them into queued requests for the
+//                       adjacent block.
+//   blk_dispatch()      moves requests from the elevator into the
+//                       virtqueue, up to iotune[IOT_DEPTH] in flight,
+//                       and tells the device about them with one kick.
+//   blk_complete()      called by virtio_disk_intr() for every
+//                       finished request; wakes the submitter of
+//                       every buf it carried and refills the device.
+//
+// submission only takes its own hart's ctx lock. queue_lock,
+// which covers the elevator and the rest of blk, is taken with
+// tryacquire(): if another hart holds it, that hart flushes our
+// request before it lets go (see blk_unlock()).
+//
+// the elevator only sees best-effort requests. real-time ones
+// wait in blk.rt, ordered by level, and always go first;
+// idle ones wait in blk.idle until nothing else has been queued
+// or in flight for iotune[IOT_IDLE_GRACE] ms.
+//
+// with a write-back cache on the device, a finished write is
+// not yet durable; rw_flush() sends a cache flush, ahead of any
+// queued requests, and waits for it.
+//
+// freed blocks are discarded in the background: bfree() adds
+// them to extents in blk.dext with blk_discard(), and once the
+// freeing transaction has committed blk_discard_commit() queues
+// each extent as one idle-class request. balloc() takes a block
+// back out with blk_undiscard(), waiting if its discard is
+// already on the device. newly allocated blocks are zeroed the
+// same way, with blk_zero(), by write-zeroes requests that the
+// commit sends and waits for before its commit record.
+//
+// an elevator may hold back requests for a while, e.g. to wait
+// for a process's next read; blk_settimer() asks blk_tick() to
+// try dispatching again when that time is up, and arms a one-shot
+// timer interrupt for it, as the tick is ~100ms and the waits are
+// often a few ms.
+//
+
+#include "types.h"
+#include "riscv.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "proc.h"
+#include "fs.h"
+#include "buf.h"
+#include "virtio.h"
+#include "iosched.h"
+#include "blk.h"
+
+// the schedulers, indexed by IO_type.
+static struct elevator_ops *elevators[] = {
+[IOSCHED_NOOP]      &noop_ops,
+[IOSCHED_CFQ]       &cfq_ops,
+[IOSCHED_SSTF]      &sstf_ops,
+[IOSCHED_DEADLINE]  &deadline_ops,
+[IOSCHED_CSCAN]     &cscan_ops,
+[IOSCHED_AS]        &as_ops,
+[IOSCHED_BFQ]       &bfq_ops,
+[IOSCHED_KYBER]     &kyber_ops,
+};
+
+int     IO_type=IOSCHED_CSCAN; //IO调度方式，默认为C-SCAN
+
+struct spinlock queue_lock;   // everything in blk, and the elevators
+
+// per-hart staging lists.
+static struct blk_ctx {
+  struct spinlock lock;  // also guards b->disk of bufs staged here
+  struct req *head;      // staged requests, through pFront
+  struct req *tail;
+} ctx[NCPU];
+
+static int pending;      // staged requests on all harts; atomic
+
+// a run of blocks to discard, or to zero.
+#define NDEXT 32
+#define DEXT_FREE    0
+#define DEXT_PENDING 1     // its transaction may not have committed
+#define DEXT_ISSUED  2     // r is queued or on the device
+
+struct dext {
+  int cmd;           // REQ_CMD_DISCARD or REQ_CMD_WZEROES
+  int state;
+  uint start;
+  uint len;
+  struct req r;
+};
+
+static struct {
+  struct elevator_ops *elv;   // elevators[IO_type]
+
+  // request objects; req[i] belongs to the buf with id i, which
+  // has at most one request outstanding, so none are ever short.
+  struct req req[NREQ];
+  uint seq;
+  int inflight;          // requests handed to the device
+  struct req *held;      // taken from its queue, but the virtqueue was full
+  uint64 timer;          // Nowtime() of the next blk_tick() dispatch, or 0
+
+  // priority classes.
+  RBTree rt;             // real-time requests by level, then seq
+  Ring idle;             // idle-class requests in arrival order
+  int nbe;               // best-effort requests in the elevator
+  int busy;              // rt and best-effort requests in flight
+  uint64 lastbusy;       // Nowtime() they were last queued or done
+
+  uint64 rsvc;           // mean read service time, us, for hybrid polling
+  uint64 stamp;          // Nowtime() stats.inprogress last changed
+
+  // cache flushes, one at a time.
+  struct sleeplock flushlock;
+  struct req flushreq;
+
+  struct dext dext[NDEXT];
+  int nzext;             // write-zeroes extents in use; read without the lock
+
+  struct iostats stats;
+  struct iohist hist[NIOSCHED];   // by the scheduler in use at completion
+} blk;
+
+// microseconds since boot, from the time CSR; much finer
+// than ticks and needs no lock.
+uint64
+Nowtime(void)
+{
+  return r_time() / (TIMEBASE / 1000000);
+}
+
+// the histogram bucket of a latency of us microseconds.
+static int
+hist_bucket(uint64 us)
+{
+  int i = 0;
+
+  while(us > 1 && i < NHIST-1){
+    us >>= 1;
+    i++;
+  }
+  return i;
+}
+
+// d requests entered (or, d < 0, left) the queues. the time
+// since the last change is charged first, at the old count.
+static void
+blk_account(int d)
+{
+  uint64 now = Nowtime();
+
+  if(blk.stats.inprogress > 0){
+    blk.stats.busy += now - blk.stamp;
+    blk.stats.weighted += (now - blk.stamp) * blk.stats.inprogress;
+  }
+  blk.stamp = now;
+  blk.stats.inprogress += d;
+}
+
+static void
+req_free(struct req *r)
+{
+  r->nseg = 0;
+  r->state = REQ_FREE;
+}
+
+void
+blkinit(void)
+{
+  initlock(&queue_lock, "queue_lock");
+  for(int i = 0; i < NCPU; i++)
+    initlock(&ctx[i].lock, "blk_ctx");
+
+  // all request objects start out free.
+  for(int i = 0; i < NREQ; i++)
+    req_free(&blk.req[i]);
+  initsleeplock(&blk.flushlock, "blk_flush");
+  req_free(&blk.flushreq);
+  for(int i = 0; i < NDEXT; i++)
+    req_free(&blk.dext[i].r);
+
+  blk.elv = elevators[IO_type];
+  blk.elv->init();
+}
+
+// the next request to send to the device, by class.
+static struct req*
+blk_next(void)
+{
+  Node *node;
+  struct req *r;
+  uint64 grace;
+
+  if((r = blk.held) != 0){
+    blk.held = 0;
+    return r;
+  }
+  if(blk.flushreq.state == REQ_QUEUED)
+    return &blk.flushreq;
+  if((node = GetFromRBTree(&blk.rt)) != 0){
+    DeleteFromRBTree(node, &blk.rt);
+    return NODE2REQ(node);
+  }
+  if((r = blk.elv->dispatch()) != 0){
+    blk.nbe--;
+    r->elv = blk.elv;
+    return r;
+  }
+  if((r = blk.idle.head) == 0 || blk.nbe > 0 || blk.busy > 0)
+    return 0;
+  grace = blk.lastbusy + iotune[IOT_IDLE_GRACE] * 1000;
+  if(Nowtime() < grace){
+    blk_settimer(grace);
+    return 0;
+  }
+  DeleteFromRing(&blk.idle, r);
+  return r;
+}
+
+// move requests from the elevator to the device until
+// iotune[IOT_DEPTH] are in flight, or the virtqueue has no room
+// for a full-sized request. a request taken out of its queue
+// just then is held, to go first next time. caller holds
+// queue_lock.
+static void
+blk_dispatch(void)
+{
+  struct req *r;
+  int n = 0;
+
+  while(blk.inflight < iotune[IOT_DEPTH] && (r = blk_next()) != 0){
+    if(virtio_disk_room() == 0){
+      blk.held = r;
+      blk.stats.exhausted++;
+      break;
+    }
+    r->state = REQ_INFLIGHT;
+    r->dtime = Nowtime();
+    blk.inflight++;
+    if(IOPRIO_PRIO_CLASS(r->ioprio) != IOPRIO_CLASS_IDLE)
+      blk.busy++;
+    blk_trace(BT_DISPATCH, r);
+    virtio_disk_start(r);
+    n++;
+  }
+  if(n > 0)
+    virtio_disk_kick();
+}
+
+// queue r by its class. a merged r has handed its buf to the
+// queued request; only the empty shell is left to free.
+static void
+blk_add(struct req *r)
+{
+  int how = ELV_NO_MERGE;
+
+  switch(IOPRIO_PRIO_CLASS(r->ioprio)){
+  case IOPRIO_CLASS_RT:
+    blk.lastbusy = r->time;
+    r->node.key = ((uint64)IOPRIO_PRIO_LEVEL(r->ioprio) << 32) | r->seq;
+    InsertToRBTree(&blk.rt, &r->node);
+    return;
+  case IOPRIO_CLASS_IDLE:
+    if(iotune[IOT_MAXSEG] > 1)
+      how = MergeToRing(&blk.idle, r);
+    if(how == ELV_NO_MERGE)
+      InsertToRing(&blk.idle, r);
+    break;
+  default:
+    blk.lastbusy = r->time;
+    if(iotune[IOT_MAXSEG] > 1 && blk.elv->merge)
+      how = blk.elv->merge(r);
+    if(how == ELV_NO_MERGE){
+      blk.nbe++;
+      blk.elv->add_request(r);
+    }
+    break;
+  }
+  if(how != ELV_NO_MERGE){
+    blk_trace(how == ELV_FRONT_MERGE ? BT_FRONTMERGE : BT_BACKMERGE, r);
+    if(how == ELV_FRONT_MERGE)
+      blk.stats.frontmerges++;
+    req_free(r);
+  }
+}
+
+// move every hart's staged requests to their queues, oldest
+// first per hart. caller holds queue_lock.
+static void
+blk_flush(void)
+{
+  struct blk_ctx *c;
+  struct req *r, *next;
+  int n = 0, m;
+
+  for(c = ctx; c < &ctx[NCPU]; c++){
+    if(c->head == 0)
+      continue;   // a request staged just now keeps pending > 0
+    acquire(&c->lock);
+    r = c->head;
+    c->head = c->tail = 0;
+    release(&c->lock);
+    m = n;
+    for(; r != 0; r = next){
+      next = r->pFront;
+      r->state = REQ_QUEUED;
+      r->seq = blk.seq++;
+      blk_add(r);
+      if(r->state == REQ_QUEUED)
+        blk_account(1);   // not merged into another
+      n++;
+    }
+    blk_trace_plug(BT_UNPLUG, c - ctx, n - m);
+  }
+  __sync_fetch_and_sub(&pending, n);
+}
+
+// flush and dispatch, unless another hart holds queue_lock;
+// then that hart's blk_unlock() does it for us.
+static void
+blk_run(void)
+{
+  while(pending > 0 && tryacquire(&queue_lock)){
+    blk_flush();
+    blk_dispatch();
+    release(&queue_lock);
+  }
+}
+
+// release queue_lock, then pick up whatever was staged
+// while we held it.
+static void
+blk_unlock(void)
+{
+  release(&queue_lock);
+  blk_run();
+}
+
+//调度函数
+// stage a read or write of b, but leave it to rw_wait() (or
+// whoever runs the queue next) to send it to the disk.
+// flags are REQ_WRITE and REQ_SYNC.
+void
+rw_submit(struct buf *b, int flags)
+{
+  struct req *r = &blk.req[b->id];
+  struct proc *p = myproc();
+  struct blk_ctx *c;
+  int prio = IOPRIO_DEFAULT, weight = IOW_DEFAULT;
+
+  // a log commit holds up every file system writer, so its
+  // I/O is never of the class (or weight) of whichever process
+  // happened to run it from end_op().
+  if(p && !log_committer(p)){
+    acquire(&p->lock);
+    prio = p->io_prio;
+    weight = p->io_weight;
+    release(&p->lock);
+  }
+
+  if(r->state != REQ_FREE)
+    panic("rw_submit");
+  r->seg[0] = b;
+  r->nseg = 1;
+  r->cmd = REQ_CMD_RW;
+  r->write = (flags & REQ_WRITE) != 0;
+  r->sync = (flags & REQ_SYNC) != 0;
+  r->poll = (flags & REQ_POLL) != 0;
+  r->blockno = b->blockno;
+  r->pid = p ? p->pid : 0;
+  r->weight = weight;
+  r->ioprio = prio;
+  r->elv = 0;
+  r->proc = p;
+  r->time = Nowtime();
+
+  push_off();
+  c = &ctx[cpuid()];
+  acquire(&c->lock);
+  pop_off();
+  r->cpu = c - ctx;
+  r->state = REQ_STAGED;
+  r->pFront = 0;
+  blk_trace(BT_QUEUE, r);
+  if(c->tail)
+    c->tail->pFront = r;
+  else {
+    blk_trace_plug(BT_PLUG, r->cpu, 0);
+    c->head = r;
+  }
+  c->tail = r;
+  b->disk = 1;  //缓存区内容已经提交给磁盘为0，未完成为1
+  release(&c->lock);
+  __sync_fetch_and_add(&pending, 1);
+}
+
+// wait for a REQ_POLL request on b by reaping completions
+// ourselves. the interrupt handler may still get there first;
+// either way blk_complete() clears b->disk.
+static void
+blk_poll(struct buf *b)
+{
+  struct req *r = &blk.req[b->id];
+  int mode = iotune[IOT_POLL];
+
+  while(b->disk == 1){
+    // nothing to poll for until it is on the device; hybrid also
+    // lets others run for the first half of its likely service.
+    // r->state and r->dtime are read without a lock: a stale
+    // value only costs a yield or a spin too many.
+    if(r->state != REQ_INFLIGHT ||
+       (mode == IOPOLL_HYBRID && Nowtime() < r->dtime + blk.rsvc / 2)){
+      yield();
+      continue;
+    }
+    virtio_disk_poll();
+  }
+}
+
+// send whatever is staged to the disk, then wait for b,
+// submitted by rw_submit(), to finish.
+void
+rw_wait(struct buf *b)
+{
+  struct blk_ctx *c = &ctx[blk.req[b->id].cpu];
+
+  blk_run();
+
+  if(blk.req[b->id].poll && iotune[IOT_POLL] != IOPOLL_OFF && myproc()){
+    blk_poll(b);
+    return;
+  }
+
+  // Wait for blk_complete() to say our request has finished,
+  // not whichever one the elevator happened to issue first.
+  acquire(&c->lock);
+  while(b->disk == 1) { //当还没有读取或写入完成时
+    sleep(b, &c->lock);
+  }
+  release(&c->lock);
+}
+
+// queue a read or write of b and wait for it to finish.
+void
+rw_queue(struct buf *b, int flags)
+{
+  rw_submit(b, flags);
+  rw_wait(b);
+}
+
+// flush the device's write cache and wait for it, so that
+// every write finished before the call is durable. it only
+// covers finished writes, so callers wait for theirs first.
+// nothing to do for a write-through device.
+void
+rw_flush(void)
+{
+  struct req *r = &blk.flushreq;
+  struct blk_ctx *c;
+
+  if(!virtio_disk_cached())
+    return;
+
+  acquiresleep(&blk.flushlock);
+  r->cmd = REQ_CMD_FLUSH;
+  r->nseg = 0;
+  r->write = 1;
+  r->sync = 1;
+  r->poll = 0;
+  r->blockno = 0;
+  r->pid = 0;
+  r->weight = IOW_DEFAULT;
+  r->ioprio = IOPRIO_DEFAULT;
+  r->elv = 0;
+  r->proc = 0;   // no one is charged for it
+  r->time = Nowtime();
+  push_off();
+  c = &ctx[cpuid()];
+  pop_off();
+  r->cpu = c - ctx;
+
+  // blk_next() sends it before anything else queued.
+  acquire(&queue_lock);
+  r->state = REQ_QUEUED;
+  r->seq = blk.seq++;
+  blk_trace(BT_QUEUE, r);
+  blk_account(1);
+  blk_dispatch();
+  blk_unlock();
+
+  acquire(&c->lock);
+  while(r->state != REQ_FREE)
+    sleep(r, &c->lock);
+  release(&c->lock);
+  releasesleep(&blk.flushlock);
+}
+
+// add block b to a pending extent of cmd that it extends, or
+// to a new one. return 0 if every extent is taken. caller
+// holds queue_lock.
+static int
+dext_add(int cmd, uint b, uint max)
+{
+  struct dext *e, *slot = 0;
+
+  for(e = blk.dext; e < &blk.dext[NDEXT]; e++){
+    if(e->state == DEXT_FREE){
+      if(slot == 0)
+        slot = e;
+      continue;
+    }
+    if(e->cmd != cmd || e->state != DEXT_PENDING || e->len >= max)
+      continue;
+    if(e->start + e->len == b || e->start == b + 1){
+      if(e->start == b + 1)
+        e->start = b;
+      e->len++;
+      return 1;
+    }
+  }
+  if(slot == 0)
+    return 0;
+  slot->cmd = cmd;
+  slot->state = DEXT_PENDING;
+  if(cmd == REQ_CMD_WZEROES)
+    blk.nzext++;
+  slot->start = b;
+  slot->len = 1;
+  return 1;
+}
+
+// the extent of cmd that holds block b, or 0.
+static struct dext*
+dext_find(int cmd, uint b)
+{
+  struct dext *e;
+
+  for(e = blk.dext; e < &blk.dext[NDEXT]; e++)
+    if(e->state != DEXT_FREE && e->cmd == cmd &&
+       b >= e->start && b < e->start + e->len)
+      return e;
+  return 0;
+}
+
+// take block b out of any extent of cmd. one still queued is
+// taken back; one on the device must finish first, or it could
+// land after b's next write. caller holds queue_lock.
+static void
+dext_cut(int cmd, uint b)
+{
+  struct dext *e, *tail;
+
+  while((e = dext_find(cmd, b)) != 0 && e->state == DEXT_ISSUED){
+    if(e->r.state != REQ_INFLIGHT){
+      if(blk.held == &e->r)
+        blk.held = 0;
+      else if(IOPRIO_PRIO_CLASS(e->r.ioprio) == IOPRIO_CLASS_RT)
+        DeleteFromRBTree(&e->r.node, &blk.rt);
+      else
+        DeleteFromRing(&blk.idle, &e->r);
+      blk_trace(BT_REQUEUE, &e->r);
+      req_free(&e->r);
+      blk_account(-1);
+      e->state = DEXT_PENDING;
+      break;
+    }
+    // its completion also flushes whatever was staged
+    // while we held queue_lock.
+    sleep(e, &queue_lock);
+  }
+  if(e == 0)
+    return;
+
+  if(e->len == 1){
+    e->state = DEXT_FREE;
+    if(cmd == REQ_CMD_WZEROES)
+      blk.nzext--;
+  }
+  else if(b == e->start){
+    e->start++;
+    e->len--;
+  } else if(b == e->start + e->len - 1){
+    e->len--;
+  } else {
+    for(tail = blk.dext; tail < &blk.dext[NDEXT]; tail++)
+      if(tail->state == DEXT_FREE)
+        break;
+    if(tail < &blk.dext[NDEXT]){
+      tail->cmd = cmd;
+      tail->state = DEXT_PENDING;
+      if(cmd == REQ_CMD_WZEROES)
+        blk.nzext++;
+      tail->start = b + 1;
+      tail->len = e->start + e->len - (b + 1);
+      e->len = b - e->start;
+    } else if(cmd == REQ_CMD_DISCARD){
+      e->len = b - e->start;   // the tail just goes undiscarded
+    }
+    // a write-zeroes extent stays whole: its tail must be zeroed
+    // before the commit, and zeroing b as well does no harm, as
+    // b is only being freed.
+  }
+}
+
+// queue a request for every pending extent of cmd.
+// caller holds queue_lock.
+static void
+dext_issue(int cmd, int ioprio)
+{
+  struct dext *e;
+  struct req *r;
+
+  for(e = blk.dext; e < &blk.dext[NDEXT]; e++){
+    if(e->state != DEXT_PENDING || e->cmd != cmd)
+      continue;
+    r = &e->r;
+    r->cmd = cmd;
+    r->nseg = 0;
+    r->write = 1;
+    r->sync = 0;
+    r->poll = 0;
+    r->blockno = e->start;
+    r->count = e->len;
+    r->pid = 0;
+    r->weight = IOW_DEFAULT;
+    r->ioprio = ioprio;
+    r->elv = 0;
+    r->proc = 0;
+    r->time = Nowtime();
+    r->cpu = 0;
+    r->state = REQ_QUEUED;
+    r->seq = blk.seq++;
+    e->state = DEXT_ISSUED;
+    blk_trace(BT_QUEUE, r);
+    blk_add(r);
+    blk_account(1);
+  }
+  blk_dispatch();
+}
+
+// block b was freed by the running transaction: add it to
+// an extent, to discard after the transaction commits. if
+// every extent is taken, b is simply not discarded.
+void
+blk_discard(uint b)
+{
+  uint max = virtio_disk_maxdiscard();
+
+  acquire(&queue_lock);
+  dext_cut(REQ_CMD_WZEROES, b);   // no need to zero it any more
+  if(max > 0)
+    dext_add(REQ_CMD_DISCARD, b, max);
+  blk_unlock();
+}
+
+// block b is being allocated again: make sure no discard
+// will reach it.
+void
+blk_undiscard(uint b)
+{
+  acquire(&queue_lock);
+  dext_cut(REQ_CMD_DISCARD, b);
+  blk_unlock();
+}
+
+// the transaction that freed the pending extents has
+// committed: queue their discards, to go when the disk is idle.
+void
+blk_discard_commit(void)
+{
+  acquire(&queue_lock);
+  dext_issue(REQ_CMD_DISCARD, IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, IOPRIO_NLEVEL-1));
+  blk_unlock();
+}
+
+// block b was just allocated: have the device zero it when the
+// transaction commits, instead of logging a block of zeros.
+// until then bread() finds it known-zero and does not read it.
+// return 0 if the device cannot write zeroes, or every extent
+// is taken; then the caller must log the zeros itself.
+int
+blk_zero(uint b)
+{
+  uint max = virtio_disk_maxzeroes();
+  int ok = 0;
+
+  acquire(&queue_lock);
+  if(max > 0)
+    ok = dext_add(REQ_CMD_WZEROES, b, max);
+  blk_unlock();
+  return ok;
+}
+
+// is block b waiting for blk_zero()'s zeroes, so that its
+// contents are known without reading it?
+int
+blk_zeroing(uint b)
+{
+  int z;
+
+  // the common case, on every cache miss, without queue_lock.
+  // an extent for b is added by the hart that zeroes b in the
+  // cache, before anyone can miss on it.
+  if(blk.nzext == 0)
+    return 0;
+  acquire(&queue_lock);
+  z = dext_find(REQ_CMD_WZEROES, b) != 0;
+  blk_unlock();
+  return z;
+}
+
+// send the zeroes of the committing transaction's new blocks,
+// ahead of other requests.
+void
+blk_zero_commit(void)
+{
+  acquire(&queue_lock);
+  dext_issue(REQ_CMD_WZEROES, IOPRIO_PRIO_VALUE(IOPRIO_CLASS_RT, IOPRIO_NLEVEL-1));
+  blk_unlock();
+}
+
+// wait for blk_zero_commit()'s zeroes to finish, so that the
+// flush before the commit record covers them.
+void
+blk_zero_wait(void)
+{
+  struct dext *e;
+
+  acquire(&queue_lock);
+again:
+  for(e = blk.dext; e < &blk.dext[NDEXT]; e++){
+    if(e->state == DEXT_ISSUED && e->cmd == REQ_CMD_WZEROES){
+      sleep(e, &queue_lock);
+      goto again;
+    }
+  }
+  blk_unlock();
+}
+
+// the device finished the requests on the list
+// (linked through pFront). called by virtio_disk_intr(), or
+// by virtio_disk_poll() for a polling submitter.
+void
+blk_complete(struct req *done)
+{
+  struct req *r;
+  uint64 now = Nowtime();
+
+  acquire(&queue_lock);
+  while((r = done) != 0){
+    done = r->pFront;
+    blk_trace(BT_COMPLETE, r);
+    if(r->proc){
+      r->proc->io_nreq++;
+      r->proc->io_wait += r->dtime - r->time;
+      r->proc->io_service += now - r->dtime;
+    }
+    if(r->elv == blk.elv && blk.elv->completed)
+      blk.elv->completed(r);
+    if(IOPRIO_PRIO_CLASS(r->ioprio) != IOPRIO_CLASS_IDLE){
+      blk.busy--;
+      blk.lastbusy = now;
+    }
+    if(!r->write)
+      blk.rsvc = (blk.rsvc * 7 + (now - r->dtime)) / 8;
+    if(r->cmd == REQ_CMD_RW){
+      struct iohist *h = &blk.hist[IO_type];
+      h->queue[r->write][hist_bucket(r->dtime - r->time)]++;
+      h->device[r->write][hist_bucket(now - r->dtime)]++;
+    }
+    // counted as they complete, as linux does, so that the
+    // requests and ticks of /diskstats agree.
+    if(r->cmd == REQ_CMD_FLUSH){
+      blk.stats.flushes++;
+      blk.stats.fticks += now - r->time;
+    } else if(r->cmd == REQ_CMD_DISCARD){
+      blk.stats.discards++;
+      blk.stats.discarded += r->count;
+      blk.stats.dticks += now - r->time;
+    } else {
+      if(r->cmd == REQ_CMD_WZEROES){
+        blk.stats.wzeroes++;
+        blk.stats.zeroed += r->count;
+      } else {
+        blk.stats.ios[r->write]++;
+        blk.stats.blocks[r->write] += r->nseg;
+        blk.stats.merges[r->write] += r->nseg - 1;   // each began as one buf
+      }
+      blk.stats.ticks[r->write] += now - r->time;
+    }
+    blk_account(-1);
+    blk.inflight--;
+
+    if(r->cmd == REQ_CMD_FLUSH){
+      struct blk_ctx *c = &ctx[r->cpu];
+      req_free(r);
+      acquire(&c->lock);
+      wakeup(r);
+      release(&c->lock);
+      continue;
+    }
+    if(r->cmd == REQ_CMD_DISCARD || r->cmd == REQ_CMD_WZEROES){
+      struct dext *e;
+      for(e = blk.dext; &e->r != r; e++)
+        ;
+      req_free(r);
+      e->state = DEXT_FREE;
+      if(e->cmd == REQ_CMD_WZEROES)
+        blk.nzext--;
+      wakeup(e);   // dext_cut() and blk_zero_wait() sleep on queue_lock
+      continue;
+    }
+
+    // free r before waking anyone: the first buf's owner may
+    // submit it again at once, reusing r.
+    struct buf *seg[MAXSEG];
+    int nseg = r->nseg;
+    for(int i = 0; i < nseg; i++)
+      seg[i] = r->seg[i];
+    req_free(r);
+    for(int i = 0; i < nseg; i++){
+      struct blk_ctx *c = &ctx[blk.req[seg[i]->id].cpu];
+      acquire(&c->lock);
+      seg[i]->disk = 0;   // disk is done with buf
+      wakeup(seg[i]);
+      release(&c->lock);
+    }
+  }
+  blk_flush();
+  blk_dispatch();
+  blk_unlock();
+}
+
+// have blk_tick() call blk_dispatch() once Nowtime() reaches
+// when. caller holds queue_lock.
+void
+blk_settimer(uint64 when)
+{
+  if(blk.timer == 0 || when < blk.timer){
+    blk.timer = when;
+    timer_oneshot(when);
+  }
+}
+
+// called by every cpu's scheduler loop, and from blk_timerintr(),
+// so it is cheap when no timer is set.
+void
+blk_tick(void)
+{
+  if(blk.timer == 0 || Nowtime() < blk.timer)
+    return;
+  acquire(&queue_lock);
+  if(blk.timer != 0 && Nowtime() >= blk.timer){
+    blk.timer = 0;
+    blk_dispatch();
+  }
+  blk_unlock();
+}
+
+// the timer interrupt. a one-shot armed on this hart for an
+// earlier timer may have gone off in place of the one still
+// pending, so arm one for that again. interrupts are off.
+void
+blk_timerintr(void)
+{
+  uint64 t;
+
+  blk_tick();
+  if((t = blk.timer) != 0)
+    timer_oneshot(t);
+}
+
+//IO调度切换
+// hand everything still queued in the old elevator to the
+// new one, oldest first, so nothing is lost or stranded.
+// real-time and idle requests are not the elevator's.
+// requests already on the device finish as usual.
+int
+IO_switch(int type)
+{
+  static struct req *queued[NREQ];
+  struct req *r;
+  int n = 0;
+
+  if(type < 0 || type >= NELEM(elevators) || elevators[type] == 0)
+    return -1;
+
+  acquire(&queue_lock);
+  for(r = blk.req; r < &blk.req[NREQ]; r++){
+    if(r->state != REQ_QUEUED || r == blk.held ||
+       IOPRIO_PRIO_CLASS(r->ioprio) == IOPRIO_CLASS_RT ||
+       IOPRIO_PRIO_CLASS(r->ioprio) == IOPRIO_CLASS_IDLE)
+      continue;
+    int i = n++;
+    for(; i > 0 && (int)(queued[i-1]->seq - r->seq) > 0; i--)
+      queued[i] = queued[i-1];
+    queued[i] = r;
+  }
+
+  if(blk.elv->exit)
+    blk.elv->exit();
+  IO_type = type;
+  blk.elv = elevators[type];
+  blk.elv->init();
+  for(int i = 0; i < n; i++){
+    blk_trace(BT_REQUEUE, queued[i]);
+    blk.elv->add_request(queued[i]);
+  }
+  blk_dispatch();
+  blk_unlock();
+  return 0;
+}
+
+// get or set the tunable param; value < 0 only reads it.
+// returns the old value, or -1 if param or value is bad.
+int
+blk_tune(int param, int value)
+{
+  int old;
+
+  if(param < 0 || param >= NIOT)
+    return -1;
+  if(value >= 0 && !iotune_ok(param, value))
+    return -1;
+
+  acquire(&queue_lock);
+  old = iotune[param];
+  if(value >= 0){
+    iotune[param] = value;
+    blk_dispatch();   // a deeper queue may take more now
+  }
+  blk_unlock();
+  return old;
+}
+
+// copy the calling process's I/O accounting to st.
+int
+blk_pstat(struct iopstat *st)
+{
+  struct proc *p = myproc();
+
+  acquire(&queue_lock);
+  st->nreq = p->io_nreq;
+  st->wait = p->io_wait;
+  st->service = p->io_service;
+  blk_unlock();
+  return 0;
+}
+
+// copy the device-wide request counts to st.
+int
+blk_stats(struct iostats *st)
+{
+  acquire(&queue_lock);
+  blk_account(0);   // bring busy and weighted up to now
+  *st = blk.stats;
+  blk_unlock();
+  virtio_disk_stats(st);
+  return 0;
+}
+
+// the name of scheduler type, or 0 if there is none.
+char*
+blk_schedname(int type)
+{
+  if(type < 0 || type >= NELEM(elevators) || elevators[type] == 0)
+    return 0;
+  return elevators[type]->name;
+}
+
+// copy the latency histograms of scheduler type into h.
+int
+blk_hist(int type, struct iohist *h)
+{
+  if(type < 0 || type >= NIOSCHED)
+    return -1;
+  acquire(&queue_lock);
+  *h = blk.hist[type];
+  blk_unlock();
+  return 0;
+}
@@ -0,0 +1,144 @@
+//
+// block request layer, shared by blk.c, the elevators
+// (elv_*.c) and the virtio driver.
+//
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#define NREQ     NBUF      // request objects, one per buf
+#define MAXSEG   8         // most blocks merged into one request
+
+// rw_queue() flags
+#define REQ_WRITE    1
+#define REQ_SYNC     2     // a write someone waits on, e.g. a log commit
+#define REQ_POLL     4     // poll for it, if iotune[IOT_POLL] allows
+
+// what a request asks the device to do
+#define REQ_CMD_RW    0    // read or write seg[]
+#define REQ_CMD_FLUSH 1    // write back the device's cache; no data
+#define REQ_CMD_DISCARD 2  // forget count blocks from blockno; no bufs
+#define REQ_CMD_WZEROES 3  // zero count blocks from blockno; no bufs
+
+// request states
+#define REQ_FREE     0
+#define REQ_QUEUED   1     // owned by the elevator
+#define REQ_INFLIGHT 2     // owned by the device
+#define REQ_STAGED   3     // on a hart's staging list
+
+#define RED 0
+#define BLACK 1
+
+// node of a red-black tree sorted by key, embedded in what it sorts.
+typedef struct Node {
+    int color;          //0 stands for red and 1 stands for black
+    uint64 key;
+    struct Node* p[3]; //p[2] for the parent, p[0] for the left child, p[1] for the right child
+} Node;
+
+typedef struct RBTree {
+    Node* root;
+    int size;
+} RBTree;
+
+struct elevator_ops;
+struct proc;
+struct iostats;
+
+// one block request, from rw_queue() until virtio_disk_intr().
+// seg[i] holds block blockno+i.
+struct req{
+  struct buf* seg[MAXSEG];
+  int nseg;
+  int write;
+  int cmd;               // REQ_CMD_*
+  int sync;              // REQ_SYNC write
+  int poll;              // REQ_POLL
+  uint blockno;
+  uint count;            // blocks, for REQ_CMD_DISCARD and _WZEROES
+  int pid;               // submitting process, 0 for none
+  int weight;            // its IO_weight()
+  int ioprio;            // its ioprio_set(), IOPRIO_*
+  uint seq;              // submission order
+  int state;
+  uint64 time;           // when it was submitted, Nowtime()
+  uint64 dtime;          // when it was dispatched
+  struct proc *proc;     // charged for the I/O, or 0
+  struct elevator_ops *elv;  // elevator that dispatched it, 0 if none
+  int cpu;               // hart whose staging list it went through
+  struct req *pFront;    // fifo links, also the staging lists
+  struct req *pBack;
+  Node node;             // sorted by blockno
+};
+
+#define NODE2REQ(n) ((struct req*)((char*)(n) - (uint64)&((struct req*)0)->node))
+
+// fifo of requests in arrival order.
+typedef struct Ring {
+    struct req* head;
+    struct req* rear;
+    int size;
+} Ring;
+
+// an I/O scheduler. blk.c calls these with queue_lock held;
+// completed, merge and exit may be 0.
+struct elevator_ops {
+  char *name;
+  void (*init)(void);                    // start with nothing queued
+  void (*add_request)(struct req*);      // take ownership of r
+  struct req* (*dispatch)(void);         // give up the next request, or 0
+  void (*completed)(struct req*);        // the device finished r
+  int (*merge)(struct req*);             // fold r into a queued request,
+                                         //   returning ELV_MERGE_*
+  void (*exit)(void);                    // forget everything queued
+};
+
+// what merge did with r.
+#define ELV_NO_MERGE     0
+#define ELV_BACK_MERGE   1   // r now follows a queued request
+#define ELV_FRONT_MERGE  2   // r now precedes a queued request
+
+extern struct elevator_ops noop_ops;
+extern struct elevator_ops cfq_ops;
+extern struct elevator_ops sstf_ops;
+extern struct elevator_ops deadline_ops;
+extern struct elevator_ops cscan_ops;
+extern struct elevator_ops as_ops;
+extern struct elevator_ops bfq_ops;
+extern struct elevator_ops kyber_ops;
+
+// blk.c
+uint64          Nowtime(void);
+void            blk_complete(struct req*);
+void            blk_settimer(uint64);
+
+// iotune.c
+extern int      iotune[];
+int             iotune_ok(int, int);
+
+// blktrace.c
+void            blk_trace(int, struct req*);
+void            blk_trace_plug(int, int, int);
+
+// rbtree.c
+void            InsertToRBTree(RBTree*, Node*);
+void            DeleteFromRBTree(Node*, RBTree*);
+Node*           GetFromRBTree(RBTree*);
+Node*           CeilOfRBTree(RBTree*, uint64);
+Node*           FloorOfRBTree(RBTree*, uint64);
+int             MergeToRBTree(RBTree*, struct req*);
+int             MergeToRing(Ring*, struct req*);
+int             req_merge(struct req*, struct req*);
+void            InsertToRing(Ring*, struct req*);
+void            DeleteFromRing(Ring*, struct req*);
+
+// virtio_disk.c
+void            virtio_disk_start(struct req*);
+void            virtio_disk_kick(void);
+void            virtio_disk_poll(void);
+int             virtio_disk_room(void);
+void            virtio_disk_stats(struct iostats*);
+int             virtio_disk_cached(void);
+int             virtio_disk_maxdiscard(void);
+int             virtio_disk_maxzeroes(void);
@@ -0,0 +1,162 @@
+//
+// block event tracing, after linux's blktrace.
+//
+// while iotune[IOT_TRACE] is set, the block layer records each
+// request's queue, merge, dispatch, completion and requeue, and
+// each hart's plug (first request staged) and unplug (staged
+// requests moved to the queues), in a ring of its own hart.
+// a hart only ever writes its own ring, with interrupts off, so
+// recording takes no lock and works under any of them.
+//
+// IO_trace() drains the rings. a reader that falls NTRACE events
+// behind a hart loses the oldest ones (the next event may be
+// landing on the oldest's slot), and gets a BT_LOST event saying
+// how many instead. events come out in order per hart; merging
+// the harts by time is up to the reader.
+//
+
+#include "types.h"
+#include "riscv.h"
+#include "defs.h"
+#include "param.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "iosched.h"
+#include "blk.h"
+
+#define NTRACE 512   // events per hart
+
+static struct {
+  struct blktrace ev[NTRACE];
+  volatile uint head;   // events ever recorded
+} ring[NCPU];
+
+static struct {
+  struct spinlock lock;
+  uint tail[NCPU];      // events read from ring[i]
+} reader;
+
+static void
+rwbs(char *s, int cmd, int write, int sync)
+{
+  if(cmd == REQ_CMD_FLUSH)
+    *s++ = 'F';
+  else if(cmd == REQ_CMD_DISCARD)
+    *s++ = 'D';
+  else if(cmd == REQ_CMD_WZEROES){
+    *s++ = 'W';
+    *s++ = 'Z';
+  } else
+    *s++ = write ? 'W' : 'R';
+  if(sync)
+    *s++ = 'S';
+  *s = 0;
+}
+
+// the next free event of this hart's ring; caller fills it in
+// and then calls bt_commit(). interrupts must be off.
+static struct blktrace*
+bt_slot(void)
+{
+  struct blktrace *e = &ring[cpuid()].ev[ring[cpuid()].head % NTRACE];
+
+  e->time = Nowtime();
+  e->sched = IO_type;
+  e->cpu = cpuid();
+  return e;
+}
+
+static void
+bt_commit(void)
+{
+  __sync_synchronize();   // the event before the new head
+  ring[cpuid()].head++;
+}
+
+// record action on r.
+void
+blk_trace(int action, struct req *r)
+{
+  struct blktrace *e;
+
+  if(!iotune[IOT_TRACE])
+    return;
+  push_off();
+  e = bt_slot();
+  e->action = action;
+  e->blockno = r->blockno;
+  e->count = r->cmd == REQ_CMD_RW ? r->nseg : r->count;
+  if(r->cmd == REQ_CMD_FLUSH)
+    e->count = 0;
+  e->pid = r->pid;
+  rwbs(e->rwbs, r->cmd, r->write, r->sync);
+  bt_commit();
+  pop_off();
+}
+
+// record a plug or unplug of hart cpu's staging list, which
+// had n requests.
+void
+blk_trace_plug(int action, int cpu, int n)
+{
+  struct blktrace *e;
+
+  if(!iotune[IOT_TRACE])
+    return;
+  push_off();
+  e = bt_slot();
+  e->action = action;
+  e->cpu = cpu;
+  e->blockno = 0;
+  e->count = n;
+  e->pid = 0;
+  e->rwbs[0] = 'N';
+  e->rwbs[1] = 0;
+  bt_commit();
+  pop_off();
+}
+
+void
+blktraceinit(void)
+{
+  initlock(&reader.lock, "blktrace");
+}
+
+// copy at most n unread events to user address addr.
+// returns how many, or -1.
+int
+blk_trace_read(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct blktrace e;
+  uint head;
+  int got = 0;
+
+  acquire(&reader.lock);
+  for(int i = 0; i < NCPU && got < n; i++){
+    uint *tail = &reader.tail[i];
+    while(got < n && *tail != (head = ring[i].head)){
+      if(head - *tail >= NTRACE){
+        memset(&e, 0, sizeof(e));
+        e.time = Nowtime();
+        e.action = BT_LOST;
+        e.cpu = i;
+        e.count = head - (NTRACE - 1) - *tail;
+        *tail = head - (NTRACE - 1);
+      } else {
+        e = ring[i].ev[*tail % NTRACE];
+        __sync_synchronize();
+        if(ring[i].head - *tail >= NTRACE)
+          continue;   // overwritten while we copied it
+        (*tail)++;
+      }
+      if(copyout(p->pagetable, addr + got * sizeof(e), (char *)&e, sizeof(e)) < 0){
+        release(&reader.lock);
+        return -1;
+      }
+      got++;
+    }
+  }
+  release(&reader.lock);
+  return got;
+}
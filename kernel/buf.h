@@ -3,6 +3,7 @@ struct buf {
   int disk;    // does disk "own" buf? 缓存区内容已经提交给磁盘为0，未完成为1
   uint dev;
   uint blockno; //块号
+  int id;       // index in bcache.buf, and of its struct req in blk.c
   struct sleeplock lock;  //缓存块睡眠锁保护对该块内容的读与写
   uint refcnt;  //当前有多少个内核线程在排队等待读缓存块
   struct buf *prev; // LRU cache list
@@ -2,6 +2,9 @@ struct buf;
 struct context;
 struct file;
 struct inode;
+struct iohist;
+struct iopstat;
+struct iostats;
 struct pipe;
 struct proc;
 struct spinlock;
@@ -14,6 +17,11 @@ void            binit(void);
 struct buf*     bread(uint, uint);
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
+void            bwrite_sync(struct buf*);
+void            bwrite_async(struct buf*, int);
+void            bwait(struct buf*);
+void            bflush(void);
+struct buf*     bgetzero(uint, uint);
 void            bpin(struct buf*);
 void            bunpin(struct buf*);
 
@@ -68,6 +76,9 @@ uint64          kfree_memory(void);
 // log.c
 void            initlog(int, struct superblock*);
 void            log_write(struct buf*);
+void            log_free(uint);
+int             log_freed(uint);
+int             log_committer(struct proc*);
 void            begin_op(void);
 void            end_op(void);
 
@@ -91,6 +102,8 @@ void            proc_mapstacks(pagetable_t);
 pagetable_t     proc_pagetable(struct proc *);
 void            proc_freepagetable(pagetable_t, uint64);
 int             kill(int);
+int             setioprio(int, int);
+int             getioprio(int);
 struct cpu*     mycpu(void);
 struct cpu*     getmycpu(void);
 struct proc*    myproc();
@@ -105,7 +118,6 @@ void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
-uint64          IO_switch(int type);
 
 // swtch.S
 void            swtch(struct context*, struct context*);
@@ -113,6 +125,7 @@ void            swtch(struct context*, struct context*);
 // spinlock.c
 void            acquire(struct spinlock*);
 int             holding(struct spinlock*);
+int             tryacquire(struct spinlock*);
 void            initlock(struct spinlock*, char*);
 void            release(struct spinlock*);
 void            push_off(void);
@@ -147,6 +160,7 @@ void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
 void            usertrapret(void);
+void            timer_oneshot(uint64);
 
 // uart.c
 void            uartinit(void);
@@ -179,12 +193,39 @@ void            plicinithart(void);
 int             plic_claim(void);
 void            plic_complete(int);
 
+// blk.c
+void            blkinit(void);
+void            rw_queue(struct buf *, int);
+void            rw_submit(struct buf *, int);
+void            rw_wait(struct buf *);
+void            rw_flush(void);
+void            blk_discard(uint);
+void            blk_undiscard(uint);
+void            blk_discard_commit(void);
+int             blk_zero(uint);
+int             blk_zeroing(uint);
+void            blk_zero_commit(void);
+void            blk_zero_wait(void);
+int             IO_switch(int);
+int             blk_tune(int, int);
+int             blk_pstat(struct iopstat*);
+int             blk_stats(struct iostats*);
+int             blk_hist(int, struct iohist*);
+char*           blk_schedname(int);
+void            blk_tick(void);
+void            blk_timerintr(void);
+extern int      IO_type;
+
+// blktrace.c
+void            blktraceinit(void);
+int             blk_trace_read(uint64, int);
+
+// diskstats.c
+void            diskstatsinit(void);
+
 // virtio_disk.c
 void            virtio_disk_init(void);
-void            virtio_disk_rw(struct buf *, int);
 void            virtio_disk_intr(void);
-void            rw_queue(struct buf *, int);
-extern int      IO_type;
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
@@ -0,0 +1,147 @@
+//
+// /diskstats: a read-only device that renders the disk's
+// counters as one line in the format of linux's
+// /proc/diskstats, so the usual tools can parse it:
+//
+//   major minor name
+//   reads merged sectors ms  writes merged sectors ms
+//   in-flight io-ms weighted-ms
+//   discards merged sectors ms  flushes ms
+//
+// followed by the schedulers, the active one in brackets,
+// as in linux's queue/scheduler.
+//
+// every read renders a fresh snapshot and returns the part
+// of it at the file's offset, so cat sees one consistent copy
+// as long as it reads it whole.
+//
+
+#include "types.h"
+#include "param.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "riscv.h"
+#include "defs.h"
+#include "iosched.h"
+
+#define VDA_MAJOR 254   // what linux usually gives virtio-blk
+#define SECTORS(blocks) ((blocks) * (BSIZE / 512))
+
+struct text {
+  char buf[512];
+  int n;
+};
+
+// one snapshot at a time; it is too big for the kernel stack's comfort.
+static struct {
+  struct sleeplock lock;
+  struct text t;
+} ds;
+
+static void
+putstr(struct text *t, char *s)
+{
+  while(*s && t->n < sizeof(t->buf))
+    t->buf[t->n++] = *s++;
+}
+
+// x in decimal, right-aligned in width columns.
+static void
+putnum(struct text *t, uint64 x, int width)
+{
+  char digits[21];
+  int i = sizeof(digits) - 1;
+
+  digits[i] = 0;
+  do {
+    digits[--i] = '0' + x % 10;
+    x /= 10;
+  } while(x != 0);
+  for(int pad = width - (sizeof(digits) - 1 - i); pad > 0; pad--)
+    putstr(t, " ");
+  putstr(t, &digits[i]);
+}
+
+static void
+render(struct text *t)
+{
+  struct iostats st;
+  char *name;
+
+  blk_stats(&st);
+  t->n = 0;
+
+  putnum(t, VDA_MAJOR, 4);
+  putnum(t, 0, 8);
+  putstr(t, " vda ");
+  putnum(t, st.ios[0], 0);
+  putstr(t, " ");
+  putnum(t, st.merges[0], 0);
+  putstr(t, " ");
+  putnum(t, SECTORS(st.blocks[0]), 0);
+  putstr(t, " ");
+  putnum(t, st.ticks[0] / 1000, 0);
+  // linux counts write-zeroes as writes.
+  putstr(t, " ");
+  putnum(t, st.ios[1] + st.wzeroes, 0);
+  putstr(t, " ");
+  putnum(t, st.merges[1], 0);
+  putstr(t, " ");
+  putnum(t, SECTORS(st.blocks[1] + st.zeroed), 0);
+  putstr(t, " ");
+  putnum(t, st.ticks[1] / 1000, 0);
+  putstr(t, " ");
+  putnum(t, st.inprogress, 0);
+  putstr(t, " ");
+  putnum(t, st.busy / 1000, 0);
+  putstr(t, " ");
+  putnum(t, st.weighted / 1000, 0);
+  putstr(t, " ");
+  putnum(t, st.discards, 0);
+  putstr(t, " 0 ");   // discards are never merged
+  putnum(t, SECTORS(st.discarded), 0);
+  putstr(t, " ");
+  putnum(t, st.dticks / 1000, 0);
+  putstr(t, " ");
+  putnum(t, st.flushes, 0);
+  putstr(t, " ");
+  putnum(t, st.fticks / 1000, 0);
+  putstr(t, "\n");
+
+  putstr(t, "scheduler:");
+  for(int i = 0; i < NIOSCHED; i++){
+    if((name = blk_schedname(i)) == 0)
+      continue;
+    putstr(t, i == IO_type ? " [" : " ");
+    putstr(t, name);
+    if(i == IO_type)
+      putstr(t, "]");
+  }
+  putstr(t, "\n");
+}
+
+static int
+diskstatsread(int user_dst, uint64 dst, uint off, int n)
+{
+  struct text *t = &ds.t;
+
+  acquiresleep(&ds.lock);
+  render(t);
+  if(off >= t->n)
+    n = 0;
+  else if(n > t->n - off)
+    n = t->n - off;
+  if(n > 0 && either_copyout(user_dst, dst, t->buf + off, n) < 0)
+    n = -1;
+  releasesleep(&ds.lock);
+  return n;
+}
+
+void
+diskstatsinit(void)
+{
+  initsleeplock(&ds.lock, "diskstats");
+  devsw[DISKSTATS].pread = diskstatsread;
+}
@@ -0,0 +1,268 @@
+//
+// as: anticipatory scheduling.
+//
+// requests are served in C-SCAN order, but when a process's
+// read finishes the dispatcher may keep the disk idle for up to
+// iotune[IOT_AS_ANTIC] us, waiting for that process's next read,
+// instead of seeking away to another request. processes that
+// read one block at a time, each depending on the last, then
+// keep the head to themselves.
+//
+// it only waits for a process that is likely to come back soon
+// and nearby: one whose mean think time (from a read finishing
+// to its next read arriving) fits in the window, and whose mean
+// seek distance is shorter than the seek to the request that
+// would otherwise go next.
+//
+// as in deadline, a request that has waited past
+// iotune[IOT_DL_READ_EXPIRE] or [IOT_DL_WRITE_EXPIRE] ms goes
+// next, waiting or not, and the sweep carries on from there.
+// and a process whose reads win iotune[IOT_DL_FIFO_BATCH] waits
+// in a row gets no more until the others have had a turn.
+//
+
+#include "types.h"
+#include "riscv.h"
+#include "defs.h"
+#include "param.h"
+#include "iosched.h"
+#include "blk.h"
+
+// what we know about one process's reads.
+struct asio {
+  int pid;              // 0 if unused
+  int queued;           // its reads in the tree
+  uint64 used;          // Nowtime() of its last read event
+  uint64 lastdone;      // Nowtime() its last read finished, 0 once it issued another
+  uint lastblock;       // block after the last one it read
+  uint64 ttime;         // mean think time, us
+  uint64 seek;          // mean seek distance, blocks
+  int samples;
+};
+
+//预期调度
+static struct asio asio[NPROC];
+static RBTree tree;            // reads and writes together, by blockno
+static Ring fifo[2];           // reads and writes, by arrival
+static uint head;              // block after the last dispatched request
+static int antic_pid;          // process we are waiting for, or 0
+static uint64 antic_end;       // give up waiting at this Nowtime()
+static int have_next;          // it came back: serve next_block first
+static uint next_block;
+static int antic_last;         // process we last waited for
+static int antic_wins;         // waits in a row it won
+
+static uint
+distance(uint x, uint y)
+{
+  return x > y ? x - y : y - x;
+}
+
+// the record of process pid. if create, take over the least
+// recently used record of a process with nothing queued.
+static struct asio*
+as_find(int pid, int create)
+{
+  struct asio *e, *lru = NULL;
+
+  for(e = asio; e < &asio[NELEM(asio)]; e++){
+    if(e->pid == pid)
+      return e;
+    if(e->queued == 0 && (lru == NULL || e->used < lru->used))
+      lru = e;
+  }
+  if(!create || lru == NULL)
+    return NULL;
+  memset(lru, 0, sizeof(*lru));
+  lru->pid = pid;
+  return lru;
+}
+
+// when the oldest request of direction d expires, or 0.
+static uint64
+as_deadline(int d)
+{
+  int ms = iotune[d ? IOT_DL_WRITE_EXPIRE : IOT_DL_READ_EXPIRE];
+
+  return fifo[d].head == NULL ? 0 : fifo[d].head->time + (uint64)ms * 1000;
+}
+
+// the oldest expired request, reads first, or NULL.
+static struct req*
+as_expired(void)
+{
+  uint64 now = Nowtime();
+
+  for(int d = 0; d < 2; d++)
+    if(fifo[d].head != NULL && now >= as_deadline(d))
+      return fifo[d].head;
+  return NULL;
+}
+
+// have blk_tick() look again when the first queued request
+// expires, should nothing else come along first.
+static void
+as_settimer(void)
+{
+  for(int d = 0; d < 2; d++)
+    if(fifo[d].head != NULL)
+      blk_settimer(as_deadline(d));
+}
+
+// the request C-SCAN would dispatch next.
+static Node*
+as_next(void)
+{
+  Node *node;
+
+  if((node = CeilOfRBTree(&tree, head)) == NULL)
+    node = GetFromRBTree(&tree);   // wrap to the lowest block
+  return node;
+}
+
+static void
+as_init(void)
+{
+  memset(asio, 0, sizeof(asio));
+  tree.root = NULL;
+  tree.size = 0;
+  for(int d = 0; d < 2; d++){
+    fifo[d].head = NULL;
+    fifo[d].rear = NULL;
+    fifo[d].size = 0;
+  }
+  head = 0;
+  antic_pid = 0;
+  have_next = 0;
+  antic_last = 0;
+  antic_wins = 0;
+}
+
+// a read from r's process arrived: learn from it, and stop
+// waiting if it was the one we were waiting for.
+static void
+as_arrive(struct req *r)
+{
+  struct asio *e;
+
+  if(r->write || r->pid == 0 || (e = as_find(r->pid, 1)) == NULL)
+    return;
+  if(e->lastdone != 0 && r->time >= e->lastdone){
+    e->ttime = (e->ttime * 7 + (r->time - e->lastdone)) / 8;
+    e->seek = (e->seek * 7 + distance(r->blockno, e->lastblock)) / 8;
+    e->samples++;
+  }
+  e->lastdone = 0;
+  e->used = r->time;
+  if(antic_pid == r->pid){
+    antic_pid = 0;
+    antic_wins++;
+    have_next = 1;
+    next_block = r->blockno;
+  }
+}
+
+static void
+as_add(struct req *r)
+{
+  struct asio *e;
+
+  as_arrive(r);
+  if(!r->write && r->pid != 0 && (e = as_find(r->pid, 0)) != NULL)
+    e->queued++;
+  InsertToRing(&fifo[r->write], r);
+  r->node.key = r->blockno;
+  InsertToRBTree(&tree, &r->node);
+}
+
+// a merged request keeps its place in the fifo, so it
+// expires with its oldest block.
+static int
+as_merge(struct req *r)
+{
+  as_arrive(r);
+  return MergeToRBTree(&tree, r);
+}
+
+static struct req*
+as_dispatch(void)
+{
+  Node *node = NULL;
+  struct req *r, *x = as_expired();
+  struct asio *e;
+
+  if(antic_pid != 0){
+    if(x == NULL && Nowtime() < antic_end){
+      as_settimer();
+      return NULL;   // keep the disk for antic_pid a little longer
+    }
+    antic_pid = 0;   // it lost: out of time, or someone expired
+    antic_wins = 0;
+  }
+
+  if(x != NULL){
+    have_next = 0;
+    node = &x->node;
+  } else if(have_next){
+    // the awaited read, or whatever it merged into.
+    have_next = 0;
+    node = FloorOfRBTree(&tree, next_block);
+    if(node && NODE2REQ(node)->blockno + NODE2REQ(node)->nseg <= next_block)
+      node = NULL;
+  }
+  if(node == NULL && (node = as_next()) == NULL)
+    return NULL;
+
+  r = NODE2REQ(node);
+  DeleteFromRing(&fifo[r->write], r);
+  DeleteFromRBTree(node, &tree);
+  head = r->blockno + r->nseg;
+  if(!r->write && r->pid != 0 && (e = as_find(r->pid, 0)) != NULL && e->queued > 0)
+    e->queued--;
+  return r;
+}
+
+// a read finished: wait for the same process's next one if
+// that is likely to beat seeking to the next queued request.
+static void
+as_completed(struct req *r)
+{
+  struct asio *e;
+  Node *node;
+  uint64 now = Nowtime();
+
+  if(r->write || r->pid == 0 || (e = as_find(r->pid, 1)) == NULL)
+    return;
+  e->lastdone = now;
+  e->lastblock = r->blockno + r->nseg;
+  e->used = now;
+
+  if(iotune[IOT_AS_ANTIC] == 0 || e->queued > 0)
+    return;   // not waiting, or it has more reads queued already
+  if(r->pid != antic_last)
+    antic_wins = 0;
+  else if(antic_wins >= iotune[IOT_DL_FIFO_BATCH]){
+    antic_wins = 0;
+    antic_last = 0;
+    return;   // it has had the disk long enough
+  }
+  if(e->samples > 0){
+    if(e->ttime > iotune[IOT_AS_ANTIC])
+      return;   // it thinks too long to be worth waiting for
+    if((node = as_next()) != NULL &&
+       distance(NODE2REQ(node)->blockno, e->lastblock) <= e->seek)
+      return;   // the next request is no farther than its reads
+  }
+  antic_pid = antic_last = r->pid;
+  antic_end = now + iotune[IOT_AS_ANTIC];
+  blk_settimer(antic_end);
+}
+
+struct elevator_ops as_ops = {
+  .name = "as",
+  .init = as_init,
+  .add_request = as_add,
+  .dispatch = as_dispatch,
+  .completed = as_completed,
+  .merge = as_merge,
+};
@@ -0,0 +1,295 @@
+//
+// bfq: budget fair queueing.
+//
+// like cfq, every process gets its own queue of requests sorted
+// by block number, and one queue at a time has the disk. but a
+// turn is measured in sectors, not time: the active queue may
+// dispatch up to its budget of sectors (at most iotune[IOT_BFQ_BUDGET])
+// or for iotune[IOT_BFQ_TIMEOUT] ms, whichever ends first.
+//
+// which queue goes next is decided by B-WF2Q+ in virtual time.
+// a queue's turn has a virtual start S and finish F = S + budget/weight;
+// among queues with S <= V, the one with the smallest F goes next.
+// V advances by the sectors served over the total busy weight,
+// so each queue's share of sectors is proportional to its
+// IO_weight().
+//
+// budgets adapt: a queue that uses all of its budget gets twice
+// as much next time, one that runs dry early gets what it used.
+//
+// a reader issues its next read only once the last one is done,
+// so its queue runs dry after every read; if that ended its turn,
+// each reader would get one request per round whatever its weight.
+// so when the active queue runs dry after a read, it keeps the
+// disk (idle, if need be) while its reads are on the device and
+// for iotune[IOT_BFQ_IDLE] us after the last one finishes, within
+// the turn's timeout.
+//
+
+#include "types.h"
+#include "riscv.h"
+#include "defs.h"
+#include "param.h"
+#include "fs.h"
+#include "iosched.h"
+#include "blk.h"
+
+#define VSHIFT 16    // fixed point for virtual time
+
+// why a turn ended
+#define BFQ_EMPTY     0
+#define BFQ_EXHAUSTED 1   // the next request would overrun the budget
+#define BFQ_TIMEOUT   2
+
+struct bfqq {
+  int pid;
+  int weight;
+  RBTree sort;          // queued requests by blockno
+  uint pos;             // block after the last dispatch
+  int busy;             // has requests, or is active
+  uint64 start;         // virtual start of its next or current turn
+  uint64 finish;        // virtual finish
+  int budget;           // sectors for a turn
+  int served;           // sectors dispatched in this turn
+  uint64 timeout;       // Nowtime() when this turn runs out
+  int reading;          // its last dispatch was a read
+  int inflight;         // its requests on the device
+  uint64 idle_end;      // Nowtime() to stop waiting for its next read
+};
+
+//bfq算法
+static struct bfqq bfqq[NPROC+1];   // one spare for kernel I/O (pid 0)
+static struct bfqq *active;
+static uint64 vtime;                // V
+static int wsum;                    // total weight of busy queues
+
+static int
+sectors(struct req *r)
+{
+  return r->nseg * (BSIZE / 512);
+}
+
+// virtual time for n sectors at weight w.
+static uint64
+vlen(int n, int w)
+{
+  return ((uint64)n << VSHIFT) / w;
+}
+
+// the queue of process pid, or a free one for it.
+static struct bfqq*
+bfq_find(int pid)
+{
+  struct bfqq *q, *idle = NULL;
+
+  for(q = bfqq; q < &bfqq[NELEM(bfqq)]; q++){
+    if(q->pid == pid)
+      return q;
+    if(idle == NULL && !q->busy && q->sort.size == 0)
+      idle = q;
+  }
+  if(idle == NULL)
+    return NULL;
+  idle->pid = pid;
+  idle->finish = 0;   // a stranger's history is not ours
+  idle->budget = iotune[IOT_BFQ_BUDGET] / 4;
+  idle->pos = 0;
+  idle->inflight = 0;
+  return idle;
+}
+
+// q turned busy: it may start no earlier than now in virtual
+// time, nor before its last turn would have finished.
+static void
+bfq_activate(struct bfqq *q)
+{
+  q->busy = 1;
+  wsum += q->weight;
+  q->start = q->finish > vtime ? q->finish : vtime;
+  q->finish = q->start + vlen(q->budget, q->weight);
+}
+
+// the eligible queue with the earliest finish. if none is
+// eligible, V jumps to the earliest start.
+static struct bfqq*
+bfq_select(void)
+{
+  struct bfqq *q, *best = NULL;
+  uint64 minstart = 0;
+  int any = 0;
+
+  for(q = bfqq; q < &bfqq[NELEM(bfqq)]; q++){
+    if(!q->busy)
+      continue;
+    if(!any || q->start < minstart)
+      minstart = q->start;
+    any = 1;
+  }
+  if(!any)
+    return NULL;
+  if(minstart > vtime)
+    vtime = minstart;
+  for(q = bfqq; q < &bfqq[NELEM(bfqq)]; q++)
+    if(q->busy && q->start <= vtime && (best == NULL || q->finish < best->finish))
+      best = q;
+  return best;
+}
+
+// end the active queue's turn. it pays for what it got, or the
+// whole budget if it ran out of time, so seeky queues cannot
+// hold the disk for long at a low price.
+static void
+bfq_expire(int why)
+{
+  struct bfqq *q = active;
+  int charge = why == BFQ_TIMEOUT ? q->budget : q->served;
+  int max = iotune[IOT_BFQ_BUDGET];
+
+  q->finish = q->start + vlen(charge, q->weight);
+  if(why == BFQ_EXHAUSTED)
+    q->budget *= 2;
+  else if(why == BFQ_EMPTY)
+    q->budget = q->served;
+  if(q->budget < MAXSEG * (BSIZE / 512))
+    q->budget = MAXSEG * (BSIZE / 512);
+  if(q->budget > max)
+    q->budget = max;
+
+  // a queue that stays busy starts its next turn where this
+  // one finished; only a queue that went idle is caught up to V.
+  if(q->sort.size > 0){
+    q->start = q->finish;
+    q->finish = q->start + vlen(q->budget, q->weight);
+  } else {
+    q->busy = 0;
+    wsum -= q->weight;
+  }
+  active = NULL;
+}
+
+static void
+bfq_init(void)
+{
+  for(struct bfqq *q = bfqq; q < &bfqq[NELEM(bfqq)]; q++){
+    q->pid = -1;
+    q->sort.root = NULL;
+    q->sort.size = 0;
+    q->busy = 0;
+    q->finish = 0;
+    q->inflight = 0;
+  }
+  active = NULL;
+  vtime = 0;
+  wsum = 0;
+}
+
+static void
+bfq_add(struct req *r)
+{
+  struct bfqq *q = bfq_find(r->pid);
+
+  if(q == NULL)
+    panic("bfq_find");
+  r->node.key = r->blockno;
+  InsertToRBTree(&q->sort, &r->node);
+  if(!q->busy){
+    q->weight = r->weight;
+    bfq_activate(q);
+  }
+}
+
+// should the disk wait for the dry active queue's next read?
+static int
+bfq_idling(uint64 now)
+{
+  if(iotune[IOT_BFQ_IDLE] == 0 || !active->reading)
+    return 0;
+  if(active->inflight > 0){
+    blk_settimer(active->timeout);   // bfq_completed() will call again
+    return 1;
+  }
+  if(now < active->idle_end){
+    blk_settimer(active->idle_end);
+    return 1;
+  }
+  return 0;
+}
+
+static struct req*
+bfq_dispatch(void)
+{
+  Node *node;
+  struct req *r;
+  uint64 now = Nowtime();
+
+  if(active){
+    if(now >= active->timeout)
+      bfq_expire(BFQ_TIMEOUT);
+    else if(active->sort.size == 0){
+      if(bfq_idling(now))
+        return NULL;
+      bfq_expire(BFQ_EMPTY);
+    }
+  }
+  for(;;){
+    if(active == NULL){
+      if((active = bfq_select()) == NULL)
+        return NULL;
+      active->served = 0;
+      active->timeout = now + iotune[IOT_BFQ_TIMEOUT] * 1000;
+    }
+    if((node = CeilOfRBTree(&active->sort, active->pos)) == NULL)
+      node = GetFromRBTree(&active->sort);
+    r = NODE2REQ(node);
+    // the next request must fit in what is left of the budget.
+    if(active->served == 0 || active->served + sectors(r) <= active->budget)
+      break;
+    bfq_expire(BFQ_EXHAUSTED);
+  }
+
+  DeleteFromRBTree(node, &active->sort);
+  active->pos = r->blockno + r->nseg;
+  active->served += sectors(r);
+  active->reading = !r->write;
+  active->inflight++;
+  vtime += vlen(sectors(r), wsum);
+  return r;
+}
+
+// the disk finished r: if it was the active queue's last,
+// start waiting for that queue's next read.
+static void
+bfq_completed(struct req *r)
+{
+  struct bfqq *q;
+
+  for(q = bfqq; q < &bfqq[NELEM(bfqq)]; q++)
+    if(q->pid == r->pid)
+      break;
+  if(q == &bfqq[NELEM(bfqq)] || q->inflight == 0)
+    return;   // dispatched before bfq_init()
+  if(--q->inflight == 0 && q == active)
+    q->idle_end = Nowtime() + iotune[IOT_BFQ_IDLE];
+}
+
+// merge only within the submitter's own queue, so one
+// process's blocks never ride in another's budget.
+static int
+bfq_merge(struct req *r)
+{
+  struct bfqq *q;
+
+  for(q = bfqq; q < &bfqq[NELEM(bfqq)]; q++)
+    if(q->pid == r->pid && q->sort.size > 0)
+      return MergeToRBTree(&q->sort, r);
+  return ELV_NO_MERGE;
+}
+
+struct elevator_ops bfq_ops = {
+  .name = "bfq",
+  .init = bfq_init,
+  .add_request = bfq_add,
+  .dispatch = bfq_dispatch,
+  .completed = bfq_completed,
+  .merge = bfq_merge,
+};
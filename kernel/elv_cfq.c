@@ -0,0 +1,159 @@
+//
+// cfq: completely fair queuing.
+//
+// every process gets its own queue of requests sorted by
+// block number. busy queues take turns on a round-robin list;
+// the active queue may dispatch for one time slice of
+// iotune[IOT_CFQ_QUANTUM] ms, scaled by the process's best-effort
+// level (level 0 twice as long, level 7 a quarter as long as the
+// default 4), but no more than iotune[IOT_CFQ_BUDGET] requests,
+// before the next queue runs.
+// inside a slice a queue sweeps upward from where it left off.
+//
+
+#include "types.h"
+#include "riscv.h"
+#include "defs.h"
+#include "param.h"
+#include "iosched.h"
+#include "blk.h"
+
+struct cfqq {
+  int pid;
+  RBTree sort;          // queued requests by blockno
+  uint pos;             // block of the last dispatch
+  int busy;             // on the round-robin list
+  struct cfqq *next;    // round-robin list
+  uint64 slice_end;     // Nowtime() when the slice runs out
+  int dispatched;       // requests dispatched in this slice
+  int level;            // best-effort level of its latest request
+};
+
+//cfq算法
+static struct cfqq cfqq[NPROC+1];   // one spare for kernel I/O (pid 0)
+static struct cfqq *rrhead, *rrtail;
+static struct cfqq *active;
+
+// the queue of process pid, or a free one for it.
+static struct cfqq*
+cfq_find(int pid)
+{
+  struct cfqq *q, *idle = NULL;
+
+  for(q = cfqq; q < &cfqq[NELEM(cfqq)]; q++){
+    if(q->sort.size == 0 && !q->busy && q != active){
+      if(idle == NULL)
+        idle = q;
+      continue;
+    }
+    if(q->pid == pid)
+      return q;
+  }
+  if(idle == NULL)
+    return NULL;
+  idle->pid = pid;
+  idle->pos = 0;
+  return idle;
+}
+
+static void
+rr_append(struct cfqq *q)
+{
+  q->busy = 1;
+  q->next = NULL;
+  if(rrtail)
+    rrtail->next = q;
+  else
+    rrhead = q;
+  rrtail = q;
+}
+
+static struct cfqq*
+rr_pop(void)
+{
+  struct cfqq *q = rrhead;
+
+  if(q){
+    rrhead = q->next;
+    if(rrhead == NULL)
+      rrtail = NULL;
+    q->busy = 0;
+  }
+  return q;
+}
+
+static void
+cfq_init(void)
+{
+  for(struct cfqq *q = cfqq; q < &cfqq[NELEM(cfqq)]; q++){
+    q->sort.root = NULL;
+    q->sort.size = 0;
+    q->busy = 0;
+  }
+  rrhead = rrtail = NULL;
+  active = NULL;
+}
+
+static void
+cfq_add(struct req *r)
+{
+  struct cfqq *q = cfq_find(r->pid);
+
+  if(q == NULL)
+    panic("cfq_find");
+  q->level = IOPRIO_PRIO_LEVEL(r->ioprio);
+  r->node.key = r->blockno;
+  InsertToRBTree(&q->sort, &r->node);
+  if(!q->busy && q != active)
+    rr_append(q);
+}
+
+static struct req*
+cfq_dispatch(void)
+{
+  Node *node;
+  uint64 now = Nowtime();
+
+  // end the active slice when the queue drains, its time is
+  // up, or it has used its request budget.
+  if(active && (active->sort.size == 0 || now >= active->slice_end ||
+                active->dispatched >= iotune[IOT_CFQ_BUDGET])){
+    if(active->sort.size > 0)
+      rr_append(active);
+    active = NULL;
+  }
+  if(active == NULL){
+    if((active = rr_pop()) == NULL)
+      return NULL;
+    active->slice_end = now + (uint64)iotune[IOT_CFQ_QUANTUM] * 1000 *
+                        (IOPRIO_NLEVEL - active->level) / 4;
+    active->dispatched = 0;
+  }
+
+  if((node = CeilOfRBTree(&active->sort, active->pos)) == NULL)
+    node = GetFromRBTree(&active->sort);
+  DeleteFromRBTree(node, &active->sort);
+  active->pos = NODE2REQ(node)->blockno;
+  active->dispatched++;
+  return NODE2REQ(node);
+}
+
+// merge only within the submitter's own queue, so one
+// process's blocks never ride in another's slice.
+static int
+cfq_merge(struct req *r)
+{
+  struct cfqq *q = cfq_find(r->pid);
+
+  if(q == NULL)
+    return ELV_NO_MERGE;
+  return MergeToRBTree(&q->sort, r);
+}
+
+struct elevator_ops cfq_ops = {
+  .name = "cfq",
+  .init = cfq_init,
+  .add_request = cfq_add,
+  .dispatch = cfq_dispatch,
+  .merge = cfq_merge,
+};
@@ -0,0 +1,58 @@
+//
+// cscan: circular SCAN. sweep upward from the head position
+// serving requests in ascending block order, then jump back
+// to the lowest pending block and sweep again.
+//
+
+#include "types.h"
+#include "param.h"
+#include "blk.h"
+
+//cscan算法
+static RBTree tree;   // reads and writes together, by blockno
+static uint head;     // block of the last dispatched request
+
+static void
+cscan_init(void)
+{
+  tree.root = NULL;
+  tree.size = 0;
+  head = 0;
+}
+
+static void
+cscan_add(struct req *r)
+{
+  r->node.key = r->blockno;
+  InsertToRBTree(&tree, &r->node);
+}
+
+static struct req*
+cscan_dispatch(void)
+{
+  Node *node;
+  struct req *r;
+
+  if((node = CeilOfRBTree(&tree, head)) == NULL)
+    node = GetFromRBTree(&tree);   // wrap to the lowest block
+  if(node == NULL)
+    return NULL;
+  r = NODE2REQ(node);
+  DeleteFromRBTree(node, &tree);
+  head = r->blockno;
+  return r;
+}
+
+static int
+cscan_merge(struct req *r)
+{
+  return MergeToRBTree(&tree, r);
+}
+
+struct elevator_ops cscan_ops = {
+  .name = "cscan",
+  .init = cscan_init,
+  .add_request = cscan_add,
+  .dispatch = cscan_dispatch,
+  .merge = cscan_merge,
+};
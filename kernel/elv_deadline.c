@@ -0,0 +1,120 @@
+//
+// deadline: per-direction red-black trees by block and rings by
+// arrival, in the style of linux's mq-deadline.
+//
+// requests go out in batches of up to iotune[IOT_DL_FIFO_BATCH],
+// each sweeping upward in block order within one direction.
+// a new batch prefers reads, but a pending write gets its turn
+// after iotune[IOT_DL_WRITES_STARVED] read batches. a batch starts
+// at the oldest request of its direction instead if that one has
+// waited past iotune[IOT_DL_READ_EXPIRE] or [IOT_DL_WRITE_EXPIRE] ms.
+//
+
+#include "types.h"
+#include "param.h"
+#include "iosched.h"
+#include "blk.h"
+
+//红黑树
+static RBTree tree[2];
+
+static Ring ring[2];
+
+static int dir;          // direction of the current batch
+static uint pos[2];      // block after the last one dispatched, per direction
+static int batching;     // requests dispatched in the current batch
+static int starved;      // read batches started while writes waited
+
+// has the oldest request of direction d waited too long?
+static int
+expired(int d)
+{
+    int ms = iotune[d ? IOT_DL_WRITE_EXPIRE : IOT_DL_READ_EXPIRE];
+    return ring[d].head != NULL && Nowtime() - ring[d].head->time >= (uint64)ms * 1000;
+}
+
+// the next request of direction d in the sweep, or NULL at the end.
+static struct req*
+next_rq(int d)
+{
+    Node* node = CeilOfRBTree(&tree[d], pos[d]);
+    return node == NULL ? NULL : NODE2REQ(node);
+}
+
+// continue the batch while it lasts, otherwise pick a
+// direction and start a new one.
+static struct req* RenewReadyArea() {
+    struct req* r = NULL;
+
+    if (batching < iotune[IOT_DL_FIFO_BATCH])
+        r = next_rq(dir);
+
+    if (r == NULL) {
+        if (tree[0].size > 0) {
+            if (tree[1].size > 0 && starved++ >= iotune[IOT_DL_WRITES_STARVED])
+                dir = 1;
+            else
+                dir = 0;
+        }
+        else if (tree[1].size > 0) {
+            dir = 1;
+        }
+        else {
+            return NULL;
+        }
+        if (dir == 1)
+            starved = 0;
+
+        // a batch starts at the oldest request if it has expired,
+        // or if the sweep has run off the top of the disk.
+        if (expired(dir) || (r = next_rq(dir)) == NULL)
+            r = ring[dir].head;
+        batching = 0;
+    }
+
+    DeleteFromRing(&ring[r->write], r);
+    DeleteFromRBTree(&r->node, &tree[r->write]);
+    pos[dir] = r->blockno + r->nseg;
+    batching++;
+    return r;
+}
+
+static void
+deadline_init(void)
+{
+  for (int i = 0; i < 2; i++) {
+      tree[i].root = NULL;
+      tree[i].size = 0;
+      ring[i].head = NULL;
+      ring[i].rear = NULL;
+      ring[i].size = 0;
+      pos[i] = 0;
+  }
+  dir = 0;
+  batching = 0;
+  starved = 0;
+}
+
+static void
+deadline_add(struct req *r)
+{
+  InsertToRing(&ring[r->write], r);
+  r->node.key = r->blockno;
+  InsertToRBTree(&tree[r->write], &r->node);
+}
+
+// a merged request keeps its place in the ring, so its
+// deadline is that of its oldest block.
+static int
+deadline_merge(struct req *r)
+{
+  return MergeToRBTree(&tree[r->write], r);
+}
+
+struct elevator_ops deadline_ops = {
+  .name = "deadline",
+  .init = deadline_init,
+  .add_request = deadline_add,
+  .dispatch = RenewReadyArea,
+  .merge = deadline_merge,
+};
@@ -0,0 +1,153 @@
+//
+// kyber: a light latency-driven throttle, in the style of
+// linux's kyber.
+//
+// requests are not reordered, only sorted into three domains:
+// reads, synchronous writes (log commits) and other writes, each
+// a fifo with its own target completion latency
+// (iotune[IOT_KY_*_LAT] us). a domain may have at most depth[d]
+// requests on the device; dispatch takes turns among domains
+// that have both requests and room.
+//
+// every KY_WINDOW us the completions are checked against the
+// targets. if more than a tenth of some domain's completions
+// missed, every domain's depth shrinks by a quarter, since a
+// shorter device queue is the one lever on latency. if none
+// missed, domains that ran into their depth grow by one again.
+//
+
+#include "types.h"
+#include "riscv.h"
+#include "defs.h"
+#include "param.h"
+#include "iosched.h"
+#include "blk.h"
+
+#define KY_READ   0
+#define KY_SYNC   1
+#define KY_WRITE  2
+#define KY_NDOM   3
+
+#define KY_WINDOW 100000   // us between depth adjustments
+
+static int latparam[KY_NDOM] = {
+[KY_READ]   IOT_KY_READ_LAT,
+[KY_SYNC]   IOT_KY_SYNC_LAT,
+[KY_WRITE]  IOT_KY_WRITE_LAT,
+};
+
+//kyber算法
+static struct {
+  Ring fifo;
+  int depth;        // tokens: most requests on the device
+  int inflight;     // requests on the device
+  int full;         // had requests but no token in this window
+  int samples;      // completions in this window
+  int misses;       // of those, slower than the target
+} dom[KY_NDOM];
+
+static int cur;                 // domain to try first
+static uint64 window_end;
+
+static int
+ky_domain(struct req *r)
+{
+  if(!r->write)
+    return KY_READ;
+  return r->sync ? KY_SYNC : KY_WRITE;
+}
+
+static void
+kyber_init(void)
+{
+  for(int d = 0; d < KY_NDOM; d++){
+    dom[d].fifo.head = dom[d].fifo.rear = NULL;
+    dom[d].fifo.size = 0;
+    dom[d].depth = iotune[IOT_DEPTH];
+    dom[d].inflight = 0;
+    dom[d].full = dom[d].samples = dom[d].misses = 0;
+  }
+  cur = 0;
+  window_end = Nowtime() + KY_WINDOW;
+}
+
+static void
+kyber_add(struct req *r)
+{
+  InsertToRing(&dom[ky_domain(r)].fifo, r);
+}
+
+static struct req*
+kyber_dispatch(void)
+{
+  struct req *r;
+
+  for(int i = 0; i < KY_NDOM; i++){
+    int d = (cur + i) % KY_NDOM;
+    if((r = dom[d].fifo.head) == NULL)
+      continue;
+    if(dom[d].inflight >= dom[d].depth){
+      dom[d].full = 1;
+      continue;
+    }
+    DeleteFromRing(&dom[d].fifo, r);
+    dom[d].inflight++;
+    cur = (d + 1) % KY_NDOM;
+    return r;
+  }
+  return NULL;
+}
+
+// resize the domains at the end of a window.
+static void
+kyber_adjust(void)
+{
+  int bad = 0, max = iotune[IOT_DEPTH];
+
+  for(int d = 0; d < KY_NDOM; d++)
+    if(dom[d].misses * 10 > dom[d].samples)
+      bad = 1;
+  for(int d = 0; d < KY_NDOM; d++){
+    if(bad)
+      dom[d].depth -= dom[d].depth / 4;
+    else if(dom[d].full)
+      dom[d].depth++;
+    if(dom[d].depth > max)
+      dom[d].depth = max;
+    if(dom[d].depth < 1)
+      dom[d].depth = 1;
+    dom[d].full = dom[d].samples = dom[d].misses = 0;
+  }
+}
+
+static void
+kyber_completed(struct req *r)
+{
+  int d = ky_domain(r);
+  uint64 now = Nowtime();
+
+  if(dom[d].inflight > 0)
+    dom[d].inflight--;
+  dom[d].samples++;
+  if(now - r->dtime > iotune[latparam[d]])
+    dom[d].misses++;
+  if(now >= window_end){
+    kyber_adjust();
+    window_end = now + KY_WINDOW;
+  }
+}
+
+static int
+kyber_merge(struct req *r)
+{
+  return MergeToRing(&dom[ky_domain(r)].fifo, r);
+}
+
+struct elevator_ops kyber_ops = {
+  .name = "kyber",
+  .init = kyber_init,
+  .add_request = kyber_add,
+  .dispatch = kyber_dispatch,
+  .completed = kyber_completed,
+  .merge = kyber_merge,
+};
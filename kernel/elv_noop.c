@@ -0,0 +1,46 @@
+//
+// noop: serve requests in arrival order.
+//
+
+#include "types.h"
+#include "param.h"
+#include "blk.h"
+
+static Ring fifo;
+
+static void
+noop_init(void)
+{
+  fifo.head = fifo.rear = NULL;
+  fifo.size = 0;
+}
+
+static void
+noop_add(struct req *r)
+{
+  InsertToRing(&fifo, r);
+}
+
+static struct req*
+noop_dispatch(void)
+{
+  struct req *r;
+
+  if((r = fifo.head) != NULL)
+    DeleteFromRing(&fifo, r);
+  return r;
+}
+
+static int
+noop_merge(struct req *r)
+{
+  return MergeToRing(&fifo, r);
+}
+
+struct elevator_ops noop_ops = {
+  .name = "noop",
+  .init = noop_init,
+  .add_request = noop_add,
+  .dispatch = noop_dispatch,
+  .merge = noop_merge,
+};
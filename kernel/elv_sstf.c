@@ -0,0 +1,103 @@
+//
+// sstf: serve the queued block nearest the last one dispatched.
+//
+
+#include "types.h"
+#include "riscv.h"
+#include "defs.h"
+#include "param.h"
+#include "blk.h"
+
+//sstf算法
+struct Queue {//创建一个队列，该队列存放缓存区送来的IO请求
+	struct req* data[NREQ];
+	int size;
+	int capacity;
+	uint head;  // block of the last dispatched request
+};
+
+static struct Queue sstfqnode;
+static struct Queue* sstfq;
+
+static int distance(uint x,uint y)
+{
+	int delta = x - y;
+	if(delta>=0)
+		return delta;
+	else{
+		delta = - delta;
+		return delta;
+	}
+}
+
+// index of the queued request closest to the head.
+static int SSTF(struct Queue* qp)
+{
+	int best = 0;
+	for(int i=1 ;i< qp->size; i++)
+	{
+		if (distance(qp->head, qp->data[i]->blockno) < distance(qp->head, qp->data[best]->blockno))
+			best = i;
+	}
+	return best;
+}
+
+
+static void enqueue(struct Queue* qp,struct req* x){
+	if (qp->size == qp->capacity){
+        panic("queue out of capacity");
+    }
+	qp->data[qp->size++] = x;
+}
+
+
+// remove and return the request closest to the head.
+static struct req* dequeue(struct Queue* qp){
+	if(qp->size == 0)
+		return NULL;
+	int i = SSTF(qp);
+	struct req* x = qp->data[i];
+	qp->data[i] = qp->data[--qp->size];
+	qp->head = x->blockno;
+	return x;
+}
+
+static void
+sstf_init(void)
+{
+  sstfq=&sstfqnode;
+  sstfq->capacity=NREQ;
+  sstfq->size=0;
+  sstfq->head=0;
+}
+
+static void
+sstf_add(struct req *r)
+{
+  enqueue(sstfq, r);
+}
+
+static struct req*
+sstf_dispatch(void)
+{
+  return dequeue(sstfq);
+}
+
+static int
+sstf_merge(struct req *r)
+{
+  int how;
+
+  for(int i = 0; i < sstfq->size; i++)
+    if((how = req_merge(sstfq->data[i], r)) != ELV_NO_MERGE)
+      return how;
+  return ELV_NO_MERGE;
+}
+
+struct elevator_ops sstf_ops = {
+  .name = "sstf",
+  .init = sstf_init,
+  .add_request = sstf_add,
+  .dispatch = sstf_dispatch,
+  .merge = sstf_merge,
+};
@@ -114,9 +114,15 @@ fileread(struct file *f, uint64 addr, int n)
   if(f->type == FD_PIPE){ //对于pipe，按照pipe方式读取
     r = piperead(f->pipe, addr, n); 
   } else if(f->type == FD_DEVICE){  
-    if(f->major < 0 || f->major >= NDEV || !devsw[f->major].read)
+    if(f->major < 0 || f->major >= NDEV)
+      return -1;
+    if(devsw[f->major].pread){
+      if((r = devsw[f->major].pread(1, addr, f->off, n)) > 0)
+        f->off += r;
+    } else if(devsw[f->major].read)
+      r = devsw[f->major].read(1, addr, n);
+    else
       return -1;
-    r = devsw[f->major].read(1, addr, n);
   } else if(f->type == FD_INODE){ //对于inode
     ilock(f->ip);
     if((r = readi(f->ip, 1, addr, f->off, n)) > 0)  //读取数据
@@ -5,7 +5,7 @@ struct file {
   char writable;
   struct pipe *pipe; // FD_PIPE
   struct inode *ip;  // FD_INODE and FD_DEVICE
-  uint off;          // FD_INODE
+  uint off;          // FD_INODE, and FD_DEVICE with pread
   short major;       // FD_DEVICE
 };
 
@@ -33,8 +33,12 @@ struct inode {
 struct devsw {
   int (*read)(int, uint64, int);
   int (*write)(int, uint64, int);
+  // optional: read at the file's offset, for devices that
+  // render a snapshot rather than a stream. used instead of read.
+  int (*pread)(int, uint64, uint, int);
 };
 
 extern struct devsw devsw[];
 
 #define CONSOLE 1
+#define DISKSTATS 2
@@ -46,15 +46,21 @@ void fsinit(int dev)
   initlog(dev, &sb);
 }
 
-// Zero a block.
+// Zero a block. Its old contents do not matter, so it is not
+// read. If the disk can write zeroes, it does so when the
+// transaction commits; otherwise the zeros are logged. They
+// are also logged if the running transaction freed the block:
+// zeroes written in place, ahead of the commit record, would
+// destroy the old owner's data should the transaction not
+// commit.
 static void
 bzero(int dev, int bno)
 {
   struct buf *bp;
 
-  bp = bread(dev, bno);
-  memset(bp->data, 0, BSIZE);
-  log_write(bp);
+  bp = bgetzero(dev, bno);
+  if(log_freed(bno) || !blk_zero(bno))
+    log_write(bp);
   brelse(bp);
 }
 
@@ -80,6 +86,7 @@ balloc(uint dev)
         bp->data[bi / 8] |= m; // Mark block in use.将该磁盘设置为已分配
         log_write(bp);
         brelse(bp);
+        blk_undiscard(b + bi); //不能让之前的discard覆盖新数据
         bzero(dev, b + bi); //清零新分配的磁盘块
         return b + bi;
       }
@@ -105,6 +112,8 @@ bfree(int dev, uint b)
   bp->data[bi / 8] &= ~m;          //将该位置标记为0
   log_write(bp);
   brelse(bp);
+  log_free(b);
+  blk_discard(b);                  //提交后再通知磁盘丢弃该块
 }
 
 // Inodes.
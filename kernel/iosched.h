@@ -0,0 +1,139 @@
+// I/O scheduler definitions shared by the kernel and user programs.
+
+// IO_schedule() policies.
+#define IOSCHED_NOOP      0
+#define IOSCHED_CFQ       1
+#define IOSCHED_SSTF      2
+#define IOSCHED_DEADLINE  3
+#define IOSCHED_CSCAN     4
+#define IOSCHED_AS        5
+#define IOSCHED_BFQ       6
+#define IOSCHED_KYBER     7
+#define NIOSCHED          8
+
+// what IO_schedule, blktrace, iolat and elvsim call them;
+// initializes a char *[NIOSCHED].
+#define IOSCHED_NAMES { \
+  [IOSCHED_NOOP]     "noop", \
+  [IOSCHED_CFQ]      "cfq", \
+  [IOSCHED_SSTF]     "sstf", \
+  [IOSCHED_DEADLINE] "ddl", \
+  [IOSCHED_CSCAN]    "cscan", \
+  [IOSCHED_AS]       "as", \
+  [IOSCHED_BFQ]      "bfq", \
+  [IOSCHED_KYBER]    "kyber", \
+}
+
+// IO_tune() parameters.
+#define IOT_DEPTH         0   // requests the dispatcher keeps in the virtqueue
+#define IOT_CFQ_QUANTUM   1   // cfq time slice, ms
+#define IOT_CFQ_BUDGET    2   // cfq requests per slice
+#define IOT_MAXSEG        3   // most blocks merged into one request; 1 disables merging
+#define IOT_DL_READ_EXPIRE     4   // deadline, as: ms a read may wait
+#define IOT_DL_WRITE_EXPIRE    5   // deadline, as: ms a write may wait
+#define IOT_DL_FIFO_BATCH      6   // deadline: requests per sorted batch; as: waits won in a row
+#define IOT_DL_WRITES_STARVED  7   // deadline: read batches before a pending write batch
+#define IOT_AS_ANTIC      8   // as: us to wait for a process's next read; 0 disables
+#define IOT_BFQ_BUDGET    9   // bfq: most sectors a queue may get per turn
+#define IOT_BFQ_TIMEOUT   10  // bfq: most ms a queue may keep its turn
+#define IOT_IDLE_GRACE    11  // ms the disk must be idle before idle-class I/O
+#define IOT_KY_READ_LAT   12  // kyber: target read latency, us
+#define IOT_KY_SYNC_LAT   13  // kyber: target sync (log commit) write latency, us
+#define IOT_KY_WRITE_LAT  14  // kyber: target latency of other writes, us
+#define IOT_IRQ_BATCH     15  // completions per disk interrupt, with EVENT_IDX
+#define IOT_POLL          16  // how bread() waits for its read, IOPOLL_*
+#define IOT_TRACE         17  // 1 records block events for IO_trace()
+#define IOT_BFQ_IDLE      18  // bfq: us to keep the disk for a reader's next read; 0 disables
+#define NIOT              19
+
+// iotune[IOT_POLL] values. a polled read is not left to the
+// interrupt: its submitter reaps the used ring itself, at once
+// (classic) or after yielding for half the usual service time
+// (hybrid).
+#define IOPOLL_OFF        0
+#define IOPOLL_CLASSIC    1
+#define IOPOLL_HYBRID     2
+
+// IO_weight() range; a process's bfq share of the disk is
+// proportional to its weight.
+#define IOW_MIN           1
+#define IOW_DEFAULT       100
+#define IOW_MAX           1000
+
+// ioprio_set() values: a class and a level within it, 0 first.
+// real-time requests always go before best-effort ones, which
+// go before idle ones; idle requests wait until the disk has
+// been idle for iotune[IOT_IDLE_GRACE] ms.
+#define IOPRIO_CLASS_RT   1
+#define IOPRIO_CLASS_BE   2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_NLEVEL     8
+#define IOPRIO_PRIO_VALUE(class, level)  (((class) << 13) | (level))
+#define IOPRIO_PRIO_CLASS(prio)          ((prio) >> 13)
+#define IOPRIO_PRIO_LEVEL(prio)          ((prio) & 0x1fff)
+#define IOPRIO_DEFAULT    IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, 4)
+
+// per-process I/O accounting, from IO_pstat().
+struct iopstat {
+  uint64 nreq;         // requests completed
+  uint64 wait;         // us spent queued in the elevator
+  uint64 service;      // us spent on the device
+};
+
+// device-wide request counts, from IO_stats(); [0] reads, [1] writes.
+struct iostats {
+  uint64 ios[2];         // requests the device completed
+  uint64 blocks[2];      // blocks they carried
+  uint64 merges[2];      // of those, merged into an already queued request
+  uint64 frontmerges;    // merged in front of it, counted at the merge
+  uint64 notifies;       // virtqueue kicks
+  uint64 nonotifies;     // kicks skipped, the device was still busy
+  uint64 interrupts;     // disk interrupts
+  uint64 intrdone;       // requests reaped by the interrupt handler
+  uint64 polldone;       // requests reaped by a polling submitter
+  uint64 exhausted;      // times a request was held back for want of a virtio request object
+  uint64 flushes;        // device cache flushes
+  uint64 discards;       // discard requests
+  uint64 discarded;      // blocks they covered
+  uint64 wzeroes;        // write-zeroes requests
+  uint64 zeroed;         // blocks they covered
+
+  // time accounting, in us, for /diskstats.
+  uint64 ticks[2];       // submission to completion, summed over requests
+  uint64 dticks;         // the same for discards
+  uint64 fticks;         // and for flushes
+  uint64 inprogress;     // requests queued or on the device now
+  uint64 busy;           // time with any request in progress
+  uint64 weighted;       // time times requests in progress
+};
+
+// latency histograms of one scheduler, from IO_hist(); [0] reads,
+// [1] writes. bucket i counts requests that took from 2^i up to
+// 2^(i+1) us, bucket 0 also those under 1 us.
+#define NHIST 24
+struct iohist {
+  uint64 queue[2][NHIST];    // submission to dispatch
+  uint64 device[2][NHIST];   // dispatch to completion
+};
+
+// block layer events, from IO_trace(), after linux's blktrace.
+#define BT_QUEUE      'Q'   // submitted
+#define BT_BACKMERGE  'M'   // merged behind a queued request
+#define BT_FRONTMERGE 'F'   // merged in front of one
+#define BT_DISPATCH   'D'   // sent to the device
+#define BT_COMPLETE   'C'   // the device finished it
+#define BT_REQUEUE    'R'   // taken off a queue to be queued again
+#define BT_PLUG       'P'   // a hart started staging requests
+#define BT_UNPLUG     'U'   // its count staged requests went to the queues
+#define BT_LOST       'X'   // count events were overwritten unread
+
+struct blktrace {
+  uint64 time;       // Nowtime(), us
+  uint blockno;
+  uint count;        // blocks
+  int pid;           // submitting process, 0 for none
+  char action;       // BT_*
+  char sched;        // IO_type at the time
+  char cpu;          // hart it happened on, or whose staging list
+  char rwbs[5];      // R, W, D (discard), F (flush) or N; Z zeroes, S sync
+};
@@ -0,0 +1,66 @@
+//
+// the I/O scheduler tunables, read by blk.c and the elevators.
+// nothing here needs the rest of the kernel, so the host
+// simulator (sim/) builds this file as is.
+//
+
+#include "types.h"
+#include "param.h"
+#include "fs.h"
+#include "virtio.h"
+#include "iosched.h"
+#include "blk.h"
+
+// tunables, indexed by IOT_*, and the values IO_tune() accepts.
+int iotune[NIOT] = {
+[IOT_DEPTH]        8,
+[IOT_CFQ_QUANTUM]  100,
+[IOT_CFQ_BUDGET]   8,
+[IOT_MAXSEG]       MAXSEG,
+[IOT_DL_READ_EXPIRE]     500,
+[IOT_DL_WRITE_EXPIRE]    5000,
+[IOT_DL_FIFO_BATCH]      16,
+[IOT_DL_WRITES_STARVED]  2,
+[IOT_AS_ANTIC]     6000,
+[IOT_BFQ_BUDGET]   256,
+[IOT_BFQ_TIMEOUT]  125,
+[IOT_IDLE_GRACE]   100,
+[IOT_KY_READ_LAT]  2000,
+[IOT_KY_SYNC_LAT]  10000,
+[IOT_KY_WRITE_LAT] 50000,
+[IOT_IRQ_BATCH]    4,
+[IOT_POLL]         IOPOLL_OFF,
+[IOT_TRACE]        0,
+[IOT_BFQ_IDLE]     8000,
+};
+
+static struct {
+  int min, max;
+} tunerange[NIOT] = {
+[IOT_DEPTH]        { 1, NUM },     // virtio_disk_room() has the last word
+[IOT_CFQ_QUANTUM]  { 1, 10000 },
+[IOT_CFQ_BUDGET]   { 1, NREQ },
+[IOT_MAXSEG]       { 1, MAXSEG },
+[IOT_DL_READ_EXPIRE]     { 1, 60000 },
+[IOT_DL_WRITE_EXPIRE]    { 1, 60000 },
+[IOT_DL_FIFO_BATCH]      { 1, NREQ },
+[IOT_DL_WRITES_STARVED]  { 0, 16 },
+[IOT_AS_ANTIC]     { 0, 1000000 },
+[IOT_BFQ_BUDGET]   { MAXSEG*(BSIZE/512), 65536 },   // room for any one request
+[IOT_BFQ_TIMEOUT]  { 1, 10000 },
+[IOT_IDLE_GRACE]   { 0, 10000 },
+[IOT_KY_READ_LAT]  { 1, 10000000 },
+[IOT_KY_SYNC_LAT]  { 1, 10000000 },
+[IOT_KY_WRITE_LAT] { 1, 10000000 },
+[IOT_IRQ_BATCH]    { 1, NUM },
+[IOT_POLL]         { IOPOLL_OFF, IOPOLL_HYBRID },
+[IOT_TRACE]        { 0, 1 },
+[IOT_BFQ_IDLE]     { 0, 1000000 },
+};
+
+// may param be set to value?
+int
+iotune_ok(int param, int value)
+{
+  return value >= tunerange[param].min && value <= tunerange[param].max;
+}
@@ -28,7 +28,13 @@
 //   block B
 //   block C
 //   ...
-// Log appends are synchronous.
+// Log appends are synchronous. The disk may cache writes, so
+// commit() flushes it wherever a later write must not reach
+// the disk ahead of an earlier one: the log before the header,
+// the header before the home blocks, the home blocks before the
+// cleared header, and the cleared header before the next
+// transaction overwrites the log (else a crash could leave the
+// old header pointing at new log contents).
 
 // Contents of the header block, used for both the on-disk header block
 // and to keep track in memory of logged block# before commit.
@@ -40,6 +46,8 @@ struct logheader {
   int block[LOGSIZE]; //log可以包含30个blocks
 };
 
+#define NFREED 64
+
 //在内存中的数据结构
 struct log {
   struct spinlock lock;
@@ -51,14 +59,37 @@ struct log {
                    // 等于0时说明当前没有正在执行的FS sys calls，
                    // 如果在end_op中发现该计数为0，说明这时候可以提交log
   int committing;  // in commit(), please wait. 表示日志系统是否正在加检查点
+  struct proc *committer; // the process running commit(), or 0
   int dev;
   struct logheader lh;
+
+  // blocks freed by the running transaction. until it commits
+  // their old contents still belong to the old owner, so a new
+  // owner must zero them through the log, not in place.
+  uint freed[NFREED];
+  int nfreed;      // > NFREED: too many to track, assume all were
 };
 struct log log;
 
 static void recover_from_log(void);
 static void commit();
 
+#define LOGBATCH 8   // most blocks in flight per batch
+
+// how many blocks write_log() and install_trans() write at once.
+// each holds a buf until its write is done, on top of the
+// transaction's blocks pinned in the cache already, and readers
+// outside any transaction on other harts need bufs too. so a
+// batch is small, and is taken only if as many bufs again stay
+// free; otherwise one block at a time, as before.
+static int
+log_batch(void)
+{
+  if(NBUF - log.lh.n >= 2 * LOGBATCH)
+    return LOGBATCH;
+  return 1;
+}
+
 void
 initlog(int dev, struct superblock *sb)
 {
@@ -74,20 +105,30 @@ initlog(int dev, struct superblock *sb)
 
 // Copy committed blocks from log to their home location
 //从日志区转移到实际位置
+// the writes go out in batches of log_batch(), each batch
+// submitted together and then waited for.
 static void
 install_trans(int recovering)
 {
-  int tail;
-
-  for (tail = 0; tail < log.lh.n; tail++) {
-    struct buf *lbuf = bread(log.dev, log.start+tail+1); // read log block读取日志区上的块
-    struct buf *dbuf = bread(log.dev, log.lh.block[tail]); // read dst读取磁盘上的实际位置
-    memmove(dbuf->data, lbuf->data, BSIZE);  // copy block to dst从块拷贝到磁盘实际位置
-    bwrite(dbuf);  // write dst to disk再重新写入磁盘
-    if(recovering == 0)
-      bunpin(dbuf); //如果不是重新恢复log，则在这里令引用-1
-    brelse(lbuf); //释放缓存lbuf
-    brelse(dbuf); //释放缓存dbuf
+  struct buf *dbuf[LOGSIZE];
+  int tail, i, n, batch = log_batch();
+
+  for (tail = 0; tail < log.lh.n; tail += n) {
+    n = log.lh.n - tail < batch ? log.lh.n - tail : batch;
+    for (i = 0; i < n; i++) {
+      struct buf *lbuf = bread(log.dev, log.start+tail+i+1); // read log block读取日志区上的块
+      dbuf[i] = bread(log.dev, log.lh.block[tail+i]); // read dst读取磁盘上的实际位置
+      memmove(dbuf[i]->data, lbuf->data, BSIZE);  // copy block to dst从块拷贝到磁盘实际位置
+      brelse(lbuf); //释放缓存lbuf
+    }
+    for (i = 0; i < n; i++)
+      bwrite_async(dbuf[i], 0);  // write dst to disk再重新写入磁盘
+    for (i = 0; i < n; i++) {
+      bwait(dbuf[i]);
+      if(recovering == 0)
+        bunpin(dbuf[i]); //如果不是重新恢复log，则在这里令引用-1
+      brelse(dbuf[i]); //释放缓存dbuf
+    }
   }
 }
 
@@ -118,7 +159,7 @@ write_head(void)
   for (i = 0; i < log.lh.n; i++) {
     hb->block[i] = log.lh.block[i]; //更新每个log块对应的结果
   }
-  bwrite(buf);//将更新后的logheader写回磁盘
+  bwrite_sync(buf);//将更新后的logheader写回磁盘
   //这里开始完成提交，发生crash可恢复
   brelse(buf);
 }
@@ -128,8 +169,10 @@ recover_from_log(void)
 {
   read_head();  //读出logheader
   install_trans(1); // if committed, copy from log to disk由于缓冲区已被清理，因此这次不需要再减少缓冲块引用次数
+  bflush();     // installed blocks are durable before the log is cleared
   log.lh.n = 0; //后两步同commit，即清除旧log
   write_head(); // clear the log
+  bflush();     // cleared before the next transaction's log writes
 }
 
 // called at the start of each FS system call.
@@ -180,7 +223,9 @@ end_op(void)
   if(do_commit){
     // call commit w/o holding locks, since not allowed
     // to sleep with locks.
+    log.committer = myproc();
     commit(); //修改commit状态
+    log.committer = 0;
     acquire(&log.lock);
     log.committing = 0;//commiting重新变为0
     wakeup(&log);//唤起一个被挂起的调用
@@ -189,19 +234,29 @@ end_op(void)
 }
 
 // Copy modified blocks from cache to log.
+// All reads of a batch come first, so that its writes reach
+// the disk together; the log blocks are adjacent and merge.
 static void
 write_log(void)
 {
-  int tail;
-
-  for (tail = 0; tail < log.lh.n; tail++) {
-    struct buf *to = bread(log.dev, log.start+tail+1); // log block从磁盘上按顺序读出日志区域磁盘块，跳过logheader
-    struct buf *from = bread(log.dev, log.lh.block[tail]); // cache block从缓存区中读出更新后的缓存块
-    memmove(to->data, from->data, BSIZE);//将数据改为更新后的数据
-    bwrite(to);  // write the log将更新后的数据写回log区
-    brelse(from);
-    brelse(to);
-    //两个缓存使用完毕
+  struct buf *to[LOGSIZE];
+  int tail, i, n, batch = log_batch();
+
+  for (tail = 0; tail < log.lh.n; tail += n) {
+    n = log.lh.n - tail < batch ? log.lh.n - tail : batch;
+    for (i = 0; i < n; i++)
+      to[i] = bread(log.dev, log.start+tail+i+1); // log block从磁盘上按顺序读出日志区域磁盘块，跳过logheader
+    for (i = 0; i < n; i++) {
+      struct buf *from = bread(log.dev, log.lh.block[tail+i]); // cache block从缓存区中读出更新后的缓存块
+      memmove(to[i]->data, from->data, BSIZE);//将数据改为更新后的数据
+      brelse(from);
+      bwrite_async(to[i], 1);  // write the log将更新后的数据写回log区
+    }
+    for (i = 0; i < n; i++) {
+      bwait(to[i]);
+      brelse(to[i]);
+    }
+    //缓存使用完毕
   }
 }
 
@@ -209,11 +264,19 @@ static void
 commit()
 {
   if (log.lh.n > 0) {
+    blk_zero_commit(); // zero the blocks it allocated, meanwhile
     write_log();     // Write modified blocks from cache to log从缓存写入磁盘
+    blk_zero_wait();
+    bflush();        // the log and the zeroes before the header
     write_head();    // Write header to disk -- the real commit更新log头写入磁盘
+    bflush();        // no FUA in virtio: the header before any home block
     install_trans(0); // Now install writes to home locations将缓存块从log区移到存储区
+    bflush();        // home blocks before the header that lets go of the log
     log.lh.n = 0; //重新设块数n=0
     write_head();    // Erase the transaction from the log将更新后的n=0写入磁盘，旧的日志释放
+    bflush();        // the cleared header before the next write_log() reuses the log
+    log.nfreed = 0;  // its frees are durable now
+    blk_discard_commit(); // blocks it freed may be discarded now
   }
 }
 
@@ -249,3 +312,39 @@ log_write(struct buf *b)
   release(&log.lock);
 }
 
+// block b was freed by the running transaction.
+void
+log_free(uint b)
+{
+  acquire(&log.lock);
+  if(log.nfreed < NFREED)
+    log.freed[log.nfreed] = b;
+  if(log.nfreed <= NFREED)
+    log.nfreed++;
+  release(&log.lock);
+}
+
+// was block b freed by the running transaction? then its old
+// contents must survive a crash before the commit record.
+int
+log_freed(uint b)
+{
+  int i, r = 0;
+
+  acquire(&log.lock);
+  if(log.nfreed > NFREED)
+    r = 1;
+  for(i = 0; i < log.nfreed && i < NFREED && !r; i++)
+    if(log.freed[i] == b)
+      r = 1;
+  release(&log.lock);
+  return r;
+}
+
+// is p running a commit? its I/O is then the log's, not its own.
+// only p sets and clears log.committer for itself, so no lock.
+int
+log_committer(struct proc *p)
+{
+  return log.committer == p;
+}
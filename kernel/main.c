@@ -27,7 +27,10 @@ main()
     binit();         // buffer cache缓存区
     iinit();         // inode table i节点表
     fileinit();      // file table文件表
+    blkinit();       // block requests and elevators块请求层
+    blktraceinit();  // block event tracing块事件跟踪
     virtio_disk_init(); // emulated hard disk虚拟硬盘
+    diskstatsinit(); // /diskstats device磁盘统计设备
     userinit();      // first user process开始创建第一个进程
     __sync_synchronize();
     started = 1;
@@ -5,6 +5,7 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "defs.h"
+#include "iosched.h"
 
 struct cpu cpus[NCPU];
 
@@ -119,6 +120,9 @@ allocproc(void)
 found:
   p->pid = allocpid();
   p->state = USED;
+  p->io_nreq = p->io_wait = p->io_service = 0;
+  p->io_weight = IOW_DEFAULT;
+  p->io_prio = IOPRIO_DEFAULT;
 
   // Allocate a trapframe page.
   if((p->trapframe = (struct trapframe *)kalloc()) == 0){
@@ -272,10 +276,14 @@ growproc(int n)
 int
 fork(void)
 {
-  int i, pid;
+  int i, pid, prio;
   struct proc *np;
   struct proc *p = myproc();
 
+  acquire(&p->lock);
+  prio = p->io_prio;
+  release(&p->lock);
+
   // Allocate process.
   if((np = allocproc()) == 0){
     return -1;
@@ -303,6 +311,9 @@ fork(void)
 
   safestrcpy(np->name, p->name, sizeof(p->name));
 
+  np->io_weight = p->io_weight;
+  np->io_prio = prio;
+
   pid = np->pid;
 
   release(&np->lock);
@@ -445,6 +456,9 @@ scheduler(void)
     // Avoid deadlock by ensuring that devices can interrupt.
     intr_on();
 
+    // an elevator may be waiting for a timeout.
+    blk_tick();
+
     for(p = proc; p < &proc[NPROC]; p++) {
       acquire(&p->lock);
       if(p->state == RUNNABLE) {
@@ -596,6 +610,49 @@ kill(int pid)
   return -1;
 }
 
+// set the I/O priority of process pid, or of the caller if
+// pid is 0. returns -1 if there is no such process.
+int
+setioprio(int pid, int prio)
+{
+  struct proc *p;
+
+  if(pid == 0)
+    pid = myproc()->pid;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      p->io_prio = prio;
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// the I/O priority of process pid, or of the caller if pid
+// is 0; -1 if there is no such process.
+int
+getioprio(int pid)
+{
+  struct proc *p;
+  int prio;
+
+  if(pid == 0)
+    pid = myproc()->pid;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      prio = p->io_prio;
+      release(&p->lock);
+      return prio;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
 // Copy to either a user address, or kernel address,
 // depending on usr_dst.
 // Returns 0 on success, -1 on error.
@@ -655,11 +712,3 @@ procdump(void)
   }
 }
 
-
-//IO调度切换
-uint64
-IO_switch(int type)
-{
-  IO_type = type;
-  return 0;
-}
\ No newline at end of file
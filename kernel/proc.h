@@ -93,6 +93,7 @@ struct proc {
   int killed;                  // If non-zero, have been killed
   int xstate;                  // Exit status to be returned to parent's wait
   int pid;                     // Process ID
+  int io_prio;                 // ioprio_set(), copied into its block requests
 
   // wait_lock must be held when using this:
   struct proc *parent;         // Parent process
@@ -106,4 +107,10 @@ struct proc {
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+  int io_weight;               // IO_weight(), copied into its block requests
+
+  // queue_lock must be held when using this:
+  uint64 io_nreq;              // block requests completed
+  uint64 io_wait;              // us they spent in the elevator
+  uint64 io_service;           // us they spent on the device
 };
@@ -0,0 +1,298 @@
+//
+// sorted and arrival-ordered request containers
+// shared by the elevators.
+//
+
+#include "types.h"
+#include "param.h"
+#include "iosched.h"
+#include "blk.h"
+
+//红黑树
+static int
+Color(Node* node) {
+    return node == NULL ? BLACK : node->color;
+}
+
+static void
+Rotate(RBTree* tree, Node* node, int dir) { //when dir == 0, left rotate, otherwise right
+    Node* newP = node->p[1 - dir];
+    node->p[1 - dir] = newP->p[dir];
+    if (newP->p[dir] != NULL)
+        newP->p[dir]->p[2] = node;  //rearrange the grandson
+    newP->p[2] = node->p[2];        //rearrange the new father
+    if (node->p[2] == NULL)
+        tree->root = newP;
+    else if (node == node->p[2]->p[0])
+        node->p[2]->p[0] = newP;
+    else
+        node->p[2]->p[1] = newP;
+    newP->p[dir] = node;
+    node->p[2] = newP; //rearrange the node itself
+}
+
+static void
+BalanceAfterAddition(Node* node, RBTree* tree) {
+    while (Color(node->p[2]) == RED) {
+        Node* p = node->p[2], * g = node->p[2]->p[2];
+        int dir = 1;
+        if (p == g->p[0]) {
+            dir = 0;
+        }
+        Node* u = g->p[1 - dir];
+        if (Color(u) == RED) {
+            p->color = BLACK;
+            u->color = BLACK;
+            g->color = RED;
+            node = g;
+        }
+        else {
+            if (node == p->p[1 - dir]) {
+                node = p;
+                Rotate(tree, node, dir); //when dir == 0, left rotate, otherwise right
+                p = node->p[2];
+            }
+            p->color = BLACK;
+            g->color = RED;
+            Rotate(tree, g, 1 - dir);
+        }
+    }
+    tree->root->color = BLACK;
+}
+
+// node took the place of a removed black node; p is its parent
+// (node itself may be NULL).
+static void
+BalanceAfterDeletion(Node* node, Node* p, RBTree* tree) {
+    while (node != tree->root && Color(node) == BLACK) {
+        int dir = (node == p->p[0]) ? 0 : 1;
+        Node* b = p->p[1 - dir];  //brother
+        if (b->color == RED) {
+            b->color = BLACK;
+            p->color = RED;
+            Rotate(tree, p, dir);
+            b = p->p[1 - dir];
+        }
+        if (Color(b->p[0]) == BLACK && Color(b->p[1]) == BLACK) {
+            b->color = RED;
+            node = p;
+            p = node->p[2];
+        }
+        else {
+            if (Color(b->p[1 - dir]) == BLACK) { //inner cousin red, outer black
+                b->p[dir]->color = BLACK;
+                b->color = RED;
+                Rotate(tree, b, 1 - dir);
+                b = p->p[1 - dir];
+            }
+            b->color = p->color;
+            p->color = BLACK;
+            b->p[1 - dir]->color = BLACK;
+            Rotate(tree, p, dir);
+            node = tree->root;
+            break;
+        }
+    }
+    if (node != NULL)
+        node->color = BLACK;
+}
+
+// put child where node was.
+static void
+Transplant(RBTree* tree, Node* node, Node* child) {
+    if (node->p[2] == NULL)
+        tree->root = child;
+    else if (node == node->p[2]->p[0])
+        node->p[2]->p[0] = child;
+    else
+        node->p[2]->p[1] = child;
+    if (child != NULL)
+        child->p[2] = node->p[2];
+}
+
+Node*
+GetFromRBTree(RBTree* tree) {
+    Node* temp = tree->root;
+    if (temp == NULL)
+        return NULL;
+    while (temp->p[0] != NULL) {
+        temp = temp->p[0];
+    } //reach the mininum of the nodes
+    return temp;
+}
+
+// the first node whose key is >= key, or NULL.
+Node*
+CeilOfRBTree(RBTree* tree, uint64 key) {
+    Node* temp = tree->root, * best = NULL;
+    while (temp != NULL) {
+        if (temp->key >= key) {
+            best = temp;
+            temp = temp->p[0];
+        }
+        else {
+            temp = temp->p[1];
+        }
+    }
+    return best;
+}
+
+// the last node whose key is <= key, or NULL.
+Node*
+FloorOfRBTree(RBTree* tree, uint64 key) {
+    Node* temp = tree->root, * best = NULL;
+    while (temp != NULL) {
+        if (temp->key <= key) {
+            best = temp;
+            temp = temp->p[1];
+        }
+        else {
+            temp = temp->p[0];
+        }
+    }
+    return best;
+}
+
+void
+InsertToRBTree(RBTree* tree, Node* x) {
+    Node* hot = NULL;
+    Node* tmp = tree->root;
+    int dir = 0;
+    while (tmp != NULL) {
+        hot = tmp;
+        if (tmp->key > x->key) {
+            dir = 0;
+            tmp = tmp->p[0];
+        }
+        else {
+            dir = 1;     //equal keys keep arrival order
+            tmp = tmp->p[1];
+        }
+    }
+    x->color = RED;
+    x->p[0] = x->p[1] = NULL;
+    x->p[2] = hot;  //initiation of the newly inserted nodes
+    if (hot == NULL)
+        tree->root = x;
+    else
+        hot->p[dir] = x;
+    tree->size++;
+    BalanceAfterAddition(x, tree);
+}
+
+void
+DeleteFromRBTree(Node* node, RBTree* tree) {
+    Node* y = node, * x, * xp;
+    int color = y->color;
+    if (node->p[0] == NULL || node->p[1] == NULL) {
+        x = node->p[node->p[0] == NULL ? 1 : 0];
+        xp = node->p[2];
+        Transplant(tree, node, x);
+    }
+    else {
+        y = node->p[1];
+        while (y->p[0] != NULL)
+            y = y->p[0];   //successor takes the place of node
+        color = y->color;
+        x = y->p[1];
+        if (y->p[2] == node) {
+            xp = y;
+        }
+        else {
+            xp = y->p[2];
+            Transplant(tree, y, x);
+            y->p[1] = node->p[1];
+            y->p[1]->p[2] = y;
+        }
+        Transplant(tree, node, y);
+        y->p[0] = node->p[0];
+        y->p[0]->p[2] = y;
+        y->color = node->color;
+    }
+    tree->size--;
+    if (color == BLACK)
+        BalanceAfterDeletion(x, xp, tree); //rebalance
+}
+
+//环
+void
+InsertToRing(Ring* ring, struct req* x) {
+    x->pFront = ring->rear;
+    x->pBack = NULL;
+    if (ring->rear != NULL)
+        ring->rear->pBack = x;
+    else
+        ring->head = x;
+    ring->rear = x;
+    ring->size++;
+}
+
+void
+DeleteFromRing(Ring* ring, struct req* x) {
+    if (x->pFront != NULL)
+        x->pFront->pBack = x->pBack;
+    else
+        ring->head = x->pBack;
+    if (x->pBack != NULL)
+        x->pBack->pFront = x->pFront;
+    else
+        ring->rear = x->pFront;
+    ring->size--;
+}
+
+//合并
+// fold the one-block request r into rq if r's block directly
+// follows or precedes rq's. returns ELV_*_MERGE.
+int
+req_merge(struct req* rq, struct req* r) {
+    if (rq->cmd != REQ_CMD_RW || r->cmd != REQ_CMD_RW ||
+        rq->write != r->write || rq->sync != r->sync || rq->nseg >= iotune[IOT_MAXSEG])
+        return ELV_NO_MERGE;
+    if (rq->blockno + rq->nseg == r->blockno) {
+        rq->seg[rq->nseg++] = r->seg[0];
+        return ELV_BACK_MERGE;
+    }
+    if (r->blockno + 1 == rq->blockno) {
+        for (int i = rq->nseg; i > 0; i--)
+            rq->seg[i] = rq->seg[i - 1];
+        rq->seg[0] = r->seg[0];
+        rq->nseg++;
+        rq->blockno = r->blockno;
+        return ELV_FRONT_MERGE;
+    }
+    return ELV_NO_MERGE;
+}
+
+// merge r with its neighbour in a tree keyed by blockno.
+// queued requests never overlap, so the only back candidate
+// is the floor of the block before r, and the only front
+// candidate starts at the block after it. a front merge
+// lowers the key by one without passing any other key,
+// so the node can stay where it is.
+int
+MergeToRBTree(RBTree* tree, struct req* r) {
+    Node* node;
+    int how;
+
+    if (r->blockno > 0 && (node = FloorOfRBTree(tree, r->blockno - 1)) != NULL &&
+        (how = req_merge(NODE2REQ(node), r)) != ELV_NO_MERGE)
+        return how;
+    if ((node = CeilOfRBTree(tree, r->blockno + 1)) != NULL &&
+        node->key == r->blockno + 1 &&
+        (how = req_merge(NODE2REQ(node), r)) != ELV_NO_MERGE) {
+        node->key = r->blockno;
+        return how;
+    }
+    return ELV_NO_MERGE;
+}
+
+// merge r with any request in the ring, newest first.
+int
+MergeToRing(Ring* ring, struct req* r) {
+    int how;
+
+    for (struct req* rq = ring->rear; rq != NULL; rq = rq->pFront)
+        if ((how = req_merge(rq, r)) != ELV_NO_MERGE)
+            return how;
+    return ELV_NO_MERGE;
+}
@@ -115,6 +115,14 @@ extern uint64 sys_write(void);
 extern uint64 sys_uptime(void);
 extern uint64 sys_sysinfo(void);
 extern uint64 sys_IO_schedule(void);
+extern uint64 sys_IO_tune(void);
+extern uint64 sys_IO_pstat(void);
+extern uint64 sys_IO_stats(void);
+extern uint64 sys_IO_weight(void);
+extern uint64 sys_ioprio_set(void);
+extern uint64 sys_ioprio_get(void);
+extern uint64 sys_IO_hist(void);
+extern uint64 sys_IO_trace(void);
 
 static uint64 (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -140,6 +148,14 @@ static uint64 (*syscalls[])(void) = {
 [SYS_close]   sys_close,
 [SYS_sysinfo]   sys_sysinfo,
 [SYS_IO_schedule] sys_IO_schedule,
+[SYS_IO_tune] sys_IO_tune,
+[SYS_IO_pstat] sys_IO_pstat,
+[SYS_IO_stats] sys_IO_stats,
+[SYS_IO_weight] sys_IO_weight,
+[SYS_ioprio_set] sys_ioprio_set,
+[SYS_ioprio_get] sys_ioprio_get,
+[SYS_IO_hist] sys_IO_hist,
+[SYS_IO_trace] sys_IO_trace,
 };
 
 void
@@ -22,3 +22,11 @@
 #define SYS_close  21
 #define SYS_sysinfo 22
 #define SYS_IO_schedule 23
+#define SYS_IO_tune 24
+#define SYS_IO_pstat 25
+#define SYS_IO_stats 26
+#define SYS_IO_weight 27
+#define SYS_ioprio_set 28
+#define SYS_ioprio_get 29
+#define SYS_IO_hist 30
+#define SYS_IO_trace 31
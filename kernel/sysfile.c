@@ -332,6 +332,7 @@ sys_open(void)
   if(ip->type == T_DEVICE){
     f->type = FD_DEVICE;
     f->major = ip->major;
+    f->off = 0;
   } else {
     f->type = FD_INODE;
     f->off = 0;
@@ -6,6 +6,7 @@
 #include "memlayout.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "iosched.h"
 
 uint64
 sys_exit(void)
@@ -131,4 +132,119 @@ sys_IO_schedule(void)
   if(argint(0, &new_type) < 0)
     return -1;
   return IO_switch(new_type);
-}
\ No newline at end of file
+}
+
+//IO调度参数
+uint64
+sys_IO_tune(void)
+{
+  int param, value;
+
+  if(argint(0, &param) < 0 || argint(1, &value) < 0)
+    return -1;
+  return blk_tune(param, value);
+}
+
+//本进程的IO统计
+uint64
+sys_IO_pstat(void)
+{
+  uint64 addr;
+  struct iopstat st;
+
+  if(argaddr(0, &addr) < 0)
+    return -1;
+  blk_pstat(&st);
+  if(copyout(myproc()->pagetable, addr, (char *)&st, sizeof(st)) < 0)
+    return -1;
+  return 0;
+}
+
+//磁盘请求与合并统计
+uint64
+sys_IO_stats(void)
+{
+  uint64 addr;
+  struct iostats st;
+
+  if(argaddr(0, &addr) < 0)
+    return -1;
+  blk_stats(&st);
+  if(copyout(myproc()->pagetable, addr, (char *)&st, sizeof(st)) < 0)
+    return -1;
+  return 0;
+}
+
+//本进程的IO权重
+// get or set the calling process's weight; weight < 0 only
+// reads it. returns the old weight, or -1 if weight is bad.
+uint64
+sys_IO_weight(void)
+{
+  int weight, old;
+  struct proc *p = myproc();
+
+  if(argint(0, &weight) < 0)
+    return -1;
+  if(weight >= 0 && (weight < IOW_MIN || weight > IOW_MAX))
+    return -1;
+  old = p->io_weight;
+  if(weight >= 0)
+    p->io_weight = weight;
+  return old;
+}
+
+//IO优先级
+// set the I/O class and level of process pid (0 for the caller).
+uint64
+sys_ioprio_set(void)
+{
+  int pid, prio, class;
+
+  if(argint(0, &pid) < 0 || argint(1, &prio) < 0)
+    return -1;
+  class = IOPRIO_PRIO_CLASS(prio);
+  if(class < IOPRIO_CLASS_RT || class > IOPRIO_CLASS_IDLE ||
+     IOPRIO_PRIO_LEVEL(prio) >= IOPRIO_NLEVEL)
+    return -1;
+  return setioprio(pid, prio);
+}
+
+uint64
+sys_ioprio_get(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  return getioprio(pid);
+}
+
+// latency histograms of scheduler type.
+uint64
+sys_IO_hist(void)
+{
+  int type;
+  uint64 addr;
+  struct iohist h;
+
+  if(argint(0, &type) < 0 || argaddr(1, &addr) < 0)
+    return -1;
+  if(blk_hist(type, &h) < 0)
+    return -1;
+  if(copyout(myproc()->pagetable, addr, (char *)&h, sizeof(h)) < 0)
+    return -1;
+  return 0;
+}
+
+// copy up to n traced block events to the user array addr.
+uint64
+sys_IO_trace(void)
+{
+  uint64 addr;
+  int n;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0 || n < 0)
+    return -1;
+  return blk_trace_read(addr, n);
+}
@@ -11,6 +11,9 @@ uint ticks;
 
 extern char trampoline[], uservec[], userret[];
 
+// in start.c, shared with timervec.
+extern uint64 timer_scratch[NCPU][7];
+
 // in kernelvec.S, calls kerneltrap().
 void kernelvec();
 
@@ -168,6 +171,29 @@ clockintr()
   release(&tickslock);
 }
 
+// have this hart's timer go off at Nowtime() us as well as at
+// the next tick, which is too coarse for the elevators' waits.
+// caller has interrupts off.
+void
+timer_oneshot(uint64 us)
+{
+  volatile uint64 *mtimecmp = (uint64*)CLINT_MTIMECMP(cpuid());
+  uint64 when = us * (TIMEBASE / 1000000);
+
+  // timervec may go off in between, but then sets
+  // mtimecmp to the next tick, which is no earlier.
+  if(when < *mtimecmp)
+    *mtimecmp = when;
+}
+
+// has a tick passed on this hart since the last call?
+static int
+timer_ticked(void)
+{
+  // swapped atomically, so timervec cannot set it in between.
+  return __sync_lock_test_and_set(&timer_scratch[cpuid()][6], 0) != 0;
+}
+
 // check if it's an external interrupt or software interrupt,
 // and handle it.
 // returns 2 if timer interrupt,
@@ -202,17 +228,24 @@ devintr()
     return 1;
   } else if(scause == 0x8000000000000001L){
     // software interrupt from a machine-mode timer interrupt,
-    // forwarded by timervec in kernelvec.S.
+    // forwarded by timervec in kernelvec.S: the tick, or a
+    // one-shot from timer_oneshot().
+    int tick = timer_ticked();
 
-    if(cpuid() == 0){
+    if(tick && cpuid() == 0){
       clockintr();
     }
+    // an elevator's timeout must not wait for this hart to
+    // get back to its scheduler loop, which under load may be
+    // many ticks away.
+    blk_timerintr();
     
     // acknowledge the software interrupt by clearing
     // the SSIP bit in sip.
     w_sip(r_sip() & ~2);
 
-    return 2;
+    // only the tick ends the running process's time slice.
+    return tick ? 2 : 1;
   } else {
     return 0;
   }
@@ -2,7 +2,8 @@
 // virtio device definitions.
 // for both the mmio interface, and virtio descriptors.
 // only tested with qemu.
-// this is the "legacy" virtio interface.
+// this is the "legacy" virtio interface, plus the version 2
+// mmio registers and the packed virtqueue of virtio 1.1.
 //
 // the virtio spec:
 // https://docs.oasis-open.org/virtio/virtio/v1.1/virtio-v1.1.pdf
@@ -11,11 +12,13 @@
 // virtio mmio control registers, mapped starting at 0x10001000.
 // from qemu virtio_mmio.h
 #define VIRTIO_MMIO_MAGIC_VALUE		0x000 // 0x74726976
-#define VIRTIO_MMIO_VERSION		0x004 // version; 1 is legacy
+#define VIRTIO_MMIO_VERSION		0x004 // version; 1 is legacy, 2 is modern
 #define VIRTIO_MMIO_DEVICE_ID		0x008 // device type; 1 is net, 2 is disk
 #define VIRTIO_MMIO_VENDOR_ID		0x00c // 0x554d4551
 #define VIRTIO_MMIO_DEVICE_FEATURES	0x010
+#define VIRTIO_MMIO_DEVICE_FEATURES_SEL	0x014 // which 32 bits of features, version 2
 #define VIRTIO_MMIO_DRIVER_FEATURES	0x020
+#define VIRTIO_MMIO_DRIVER_FEATURES_SEL	0x024
 #define VIRTIO_MMIO_GUEST_PAGE_SIZE	0x028 // page size for PFN, write-only
 #define VIRTIO_MMIO_QUEUE_SEL		0x030 // select queue, write-only
 #define VIRTIO_MMIO_QUEUE_NUM_MAX	0x034 // max size of current queue, read-only
@@ -27,6 +30,13 @@
 #define VIRTIO_MMIO_INTERRUPT_STATUS	0x060 // read-only
 #define VIRTIO_MMIO_INTERRUPT_ACK	0x064 // write-only
 #define VIRTIO_MMIO_STATUS		0x070 // read/write
+#define VIRTIO_MMIO_QUEUE_DESC_LOW	0x080 // physical address for descriptor table, write-only
+#define VIRTIO_MMIO_QUEUE_DESC_HIGH	0x084
+#define VIRTIO_MMIO_DRIVER_DESC_LOW	0x090 // physical address for driver area, write-only
+#define VIRTIO_MMIO_DRIVER_DESC_HIGH	0x094
+#define VIRTIO_MMIO_DEVICE_DESC_LOW	0x0a0 // physical address for device area, write-only
+#define VIRTIO_MMIO_DEVICE_DESC_HIGH	0x0a4
+#define VIRTIO_MMIO_CONFIG		0x100 // device-specific configuration
 
 // status register bits, from qemu virtio_config.h
 #define VIRTIO_CONFIG_S_ACKNOWLEDGE	1
@@ -36,12 +46,23 @@
 
 // device feature bits
 #define VIRTIO_BLK_F_RO              5	/* Disk is read-only */
+#define VIRTIO_BLK_F_FLUSH           9	/* Cache flush command support */
 #define VIRTIO_BLK_F_SCSI            7	/* Supports scsi command passthru */
 #define VIRTIO_BLK_F_CONFIG_WCE     11	/* Writeback mode available in config */
 #define VIRTIO_BLK_F_MQ             12	/* support more than one vq */
+#define VIRTIO_BLK_F_DISCARD        13	/* Discard command support */
+#define VIRTIO_BLK_F_WRITE_ZEROES   14	/* Write zeroes command support */
 #define VIRTIO_F_ANY_LAYOUT         27
 #define VIRTIO_RING_F_INDIRECT_DESC 28
 #define VIRTIO_RING_F_EVENT_IDX     29
+#define VIRTIO_F_VERSION_1          32  /* modern device; required by version 2 */
+#define VIRTIO_F_RING_PACKED        34
+
+// virtio-blk configuration space, offsets from VIRTIO_MMIO_CONFIG.
+#define VIRTIO_BLK_CONFIG_WRITEBACK  32   // uint8, 1 for write-back; with VIRTIO_BLK_F_CONFIG_WCE
+#define VIRTIO_BLK_CONFIG_NUM_QUEUES 34   // uint16, with VIRTIO_BLK_F_MQ
+#define VIRTIO_BLK_CONFIG_MAX_DISCARD_SECTORS 36  // uint32, with VIRTIO_BLK_F_DISCARD
+#define VIRTIO_BLK_CONFIG_MAX_WRITE_ZEROES_SECTORS 48  // uint32, with VIRTIO_BLK_F_WRITE_ZEROES
 
 // this many virtio descriptors.
 // must be a power of two.
@@ -56,13 +77,14 @@ struct virtq_desc {
 };
 #define VRING_DESC_F_NEXT  1 // chained with another descriptor
 #define VRING_DESC_F_WRITE 2 // device writes (vs read)
+#define VRING_DESC_F_INDIRECT 4 // addr/len is a table of descriptors
 
 // the (entire) avail ring, from the spec.
 struct virtq_avail {
   uint16 flags; // always zero
   uint16 idx;   // driver will write ring[idx] next
   uint16 ring[NUM]; // descriptor numbers of chain heads
-  uint16 unused;
+  uint16 used_event; // with EVENT_IDX: interrupt once used idx passes this
 };
 
 // one entry in the "used" ring, with which the
@@ -76,13 +98,46 @@ struct virtq_used {
   uint16 flags; // always zero
   uint16 idx;   // device increments when it adds a ring[] entry
   struct virtq_used_elem ring[NUM];
+  uint16 avail_event; // with EVENT_IDX: notify once avail idx passes this
+};
+
+// with EVENT_IDX, has idx moved past event in going from old to new?
+// (Section 2.6.7.2 of the spec.)
+#define VRING_NEED_EVENT(event, new, old) \
+  ((uint16)((new) - (event) - 1) < (uint16)((new) - (old)))
+
+// with VIRTIO_F_RING_PACKED, a single ring of descriptors takes
+// the place of the descriptor table and both rings (Section 2.7).
+// the driver makes a descriptor available by setting its AVAIL
+// flag to its wrap counter and USED to the opposite; the device
+// marks it used by setting both to its own wrap counter.
+struct pvirtq_desc {
+  uint64 addr;
+  uint32 len;
+  uint16 id;    // buffer id, handed back when used
+  uint16 flags; // VRING_DESC_F_* and the two below
 };
+#define VRING_PACKED_DESC_F_AVAIL 7   // bit numbers
+#define VRING_PACKED_DESC_F_USED  15
+
+// event suppression for a packed ring; the driver's says when
+// to interrupt, the device's when to notify.
+struct pvirtq_event_suppress {
+  uint16 off_wrap;  // ring offset, and wrap counter in bit 15
+  uint16 flags;     // VRING_PACKED_EVENT_FLAG_*
+};
+#define VRING_PACKED_EVENT_FLAG_ENABLE  0
+#define VRING_PACKED_EVENT_FLAG_DISABLE 1
+#define VRING_PACKED_EVENT_FLAG_DESC    2   // at off_wrap, with EVENT_IDX
 
 // these are specific to virtio block devices, e.g. disks,
 // described in Section 5.2 of the spec.
 
 #define VIRTIO_BLK_T_IN  0 // read the disk
 #define VIRTIO_BLK_T_OUT 1 // write the disk
+#define VIRTIO_BLK_T_FLUSH 4 // write the device's cache to the disk
+#define VIRTIO_BLK_T_DISCARD 11 // the device may forget a range of sectors
+#define VIRTIO_BLK_T_WRITE_ZEROES 13 // zero a range of sectors
 
 // the format of the first descriptor in a disk request.
 // to be followed by two more descriptors containing
@@ -96,3 +151,10 @@ struct virtio_blk_req {
   uint32 reserved;
   uint64 sector;
 };
+
+// the data of a discard or write-zeroes: a range of sectors.
+struct virtio_blk_discard_write_zeroes {
+  uint64 sector;
+  uint32 num_sectors;
+  uint32 flags;
+};
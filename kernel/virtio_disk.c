@@ -1,7 +1,9 @@
 //
 // driver for qemu's virtio disk device.
 // uses qemu's mmio interface to virtio.
-// qemu presents a "legacy" virtio interface.
+// qemu presents a "legacy" virtio interface by default; with
+// -global virtio-mmio.force-legacy=false it presents version 2,
+// and with -global virtio-blk-device.packed=on also packed rings.
 //
 // qemu ... -drive file=fs.img,if=none,format=raw,id=x0 -device virtio-blk-device,drive=x0,bus=virtio-mmio-bus.0
 //
@@ -16,87 +18,29 @@
 #include "fs.h"
 #include "buf.h"
 #include "virtio.h"
+#include "iosched.h"
+#include "blk.h"
 
 // the address of virtio mmio register r //virtio mmio寄存器r的地址。
 #define R(r) ((volatile uint32 *)(VIRTIO0 + (r)))
 
-#define NULL 0
-#define TREESIZE 128 
-#define RED 0
-#define BLACK 1 
-
-
-struct req{
-  struct buf* b;
-  int write;
-};
-
-struct HNode{
-    struct req data[128];//表示堆的数组 大小要在用户输入的元素个数上+1
-    int Size;//数组里已有的元素(不包含a[0]) 
-    int Capacity; //数组的数量上限
+// a preformatted request: d[0] is the header, d[1..nseg] the
+// data and d[MAXSEG+1] the status, linked through next = base + i.
+// submitting only fills in the sector, the data addresses and
+// which data descriptor ends the chain.
+struct vreq {
+  struct virtio_blk_req hdr;
+  struct virtio_blk_discard_write_zeroes range;  // data of a discard or write-zeroes
+  char status;           // device writes 0 on success
+  int head;              // ring descriptor of the chain
+  struct virtq_desc *d;  // its MAXSEG+2 descriptors
+  int base;              // index of d[0] in the ring, or 0 in its table
+  struct pvirtq_desc *pd;  // the same table, for a packed ring
+  struct req *r;         // block request it carries, or 0
 };
-typedef struct HNode * MinHeap;//结构体指针
-
- 
-int     IO_type=0; //IO调度方式，默认为noop
-
-
-
-static struct req r;
-static struct buf temp;
-struct spinlock queue_lock;
-struct spinlock output;
-
-
-
-
-extern uint ticks;
-
-typedef struct Node {
-    int rank;           //the position in the RBTree blocks
-    int color;          //0 stands for red and 1 stands for black
-    struct req data;
-    struct Node* p[3]; //p[2] for the parent, p[0] for the left child, p[1] for the right child
-    struct Section* pSection;
-} Node;
-
-typedef struct RBTree {
-    Node node[TREESIZE];
-    Node sen;
-    Node* root;
-    int pos;
-    int avail[TREESIZE];
-    int size; // the previous number of nodes
-    int capacity;
-} RBTree;
-
-typedef struct Section {
-    int rank;
-    int time;
-    struct req data;
-    struct Section* pFront;
-    struct Section* pBack;
-    Node* pNode;
-} Section;
 
-typedef struct Ring {
-    Section section[TREESIZE];
-    Section sen;
-    Section* head;
-    Section* rear;
-    int pos;
-    int avail[TREESIZE];
-    int timeLimit;
-    int size;
-    int capacity;
-} Ring;
-
-
-
-
-
-static struct disk {
+// one virtqueue and our book-keeping for it.
+struct virtq {
   // the virtio driver and device mostly communicate through a set of
   // structures in RAM. pages[] allocates that memory. pages[] is a
   // global (instead of calls to kalloc()) because it must consist of
@@ -113,7 +57,7 @@ static struct disk {
   // https://docs.oasis-open.org/virtio/virtio/v1.1/virtio-v1.1.pdf
   //pages[]被划分为三个区域（DMA描述符，希望处理的描述符，和已经使用的描述符）
 
-  
+
   // the first region of pages[] is a set (not a ring) of DMA
   // descriptors, with which the driver tells the device where to read
   // and write individual disk operations. there are NUM descriptors.
@@ -150,732 +94,591 @@ static struct disk {
   //指向页面[]。
   struct virtq_used *used;
 
+  // with a packed ring, pages[] holds instead the ring of NUM
+  // descriptors, then the driver's event suppression, and in
+  // the second page the device's.
+  //紧凑环：描述符、可用与已用条目共用一个环。
+  struct pvirtq_desc *ring;
+  struct pvirtq_event_suppress *driver_event;
+  struct pvirtq_event_suppress *device_event;
+
   // our own book-keeping.
-  char free[NUM];  // is a descriptor free?用来表示是否每个描述符是否空闲
   uint16 used_idx; // we've looked this far in used[2..NUM].
 
-  // track info about in-flight operations,
-  // for use when completion interrupt arrives.
-  // indexed by first descriptor index of chain.
-  //关于飞行中操作的跟踪信息，供完成中断到达时使用。由链的第一个描述符索引。
-  struct {
-    struct buf *b;
-    char status;
-  } info[NUM];
-
-  // disk command headers.
-  // one-for-one with descriptors, for convenience.
-  //磁盘命令头。
-  //为了方便起见，一对一使用描述符。
-  struct virtio_blk_req ops[NUM];
-  
-  struct spinlock vdisk_lock;
-
-
-  //链表
-  struct HNode hnode;
-  MinHeap heap;
+  // packed ring positions. slots from pub_pos up to avail_pos
+  // are filled in but not yet marked available.
+  uint16 avail_pos;
+  uint16 pub_pos;
+  int pub_wrap;      // wrap counter at pub_pos
+  uint16 used_pos;   // next slot the device marks used
+  int used_wrap;
+
+  // request objects, each with its own header, status byte and
+  // chain of MAXSEG+2 descriptors, linked once by vreq_init().
+  // with VIRTIO_RING_F_INDIRECT_DESC a chain sits in its own
+  // table of indirect[] behind a single ring descriptor, so there
+  // is one per ring descriptor; otherwise each owns MAXSEG+2 ring
+  // descriptors and there are NUM/(MAXSEG+2).
+  //请求对象：初始化时就连好描述符链，提交时只填扇区和数据地址。
+  struct vreq vreq[NUM];
+  int nvreq;
+  int stride;        // ring descriptors per vreq
+  int freevreq[NUM]; // stack of free vreqs
+  int nfree;         // how many are
+
+  // indirect descriptor tables, one per vreq.
+  //间接描述符表：每个请求只占用环中的一个描述符。
+  struct virtq_desc indirect[NUM][MAXSEG+2];
+
+  int inflight;      // requests the device has not finished
+  int staged;        // avail entries written past avail->idx, not yet published
+
+  struct spinlock lock;
+
+} __attribute__ ((aligned (PGSIZE)));
+
+// with VIRTIO_BLK_F_MQ the device has several virtqueues; each
+// hart's requests go on its own, disk.q[r->cpu % disk.nq], by
+// the hart they were submitted on rather than whichever one
+// happens to dispatch them.
+#define NVQ NCPU
 
+static struct disk {
+  struct virtq q[NVQ];
+  int nq;            // virtqueues in use
+  int version;       // of the mmio interface, 1 or 2
+  int indirect;      // VIRTIO_RING_F_INDIRECT_DESC negotiated
+  int event_idx;     // VIRTIO_RING_F_EVENT_IDX negotiated
+  int packed;        // VIRTIO_F_RING_PACKED negotiated
+  int cached;        // write-back cache; writes need VIRTIO_BLK_T_FLUSH
+  int maxdiscard;    // blocks per VIRTIO_BLK_T_DISCARD, 0 if none
+  int maxzeroes;     // blocks per VIRTIO_BLK_T_WRITE_ZEROES, 0 if none
+
+  // counters for IO_stats(), updated without a lock.
+  uint64 notifies, nonotifies, interrupts;
+  uint64 intrdone, polldone;
+} disk;
+
+static void vreq_init(struct virtq*);
+
+// the features the driver handles.
+#define FEATURE(f) ((uint64)1 << (f))
+#define DRIVER_FEATURES (FEATURE(VIRTIO_F_VERSION_1) | FEATURE(VIRTIO_F_RING_PACKED) | \
+  FEATURE(VIRTIO_RING_F_INDIRECT_DESC) | FEATURE(VIRTIO_RING_F_EVENT_IDX) | \
+  FEATURE(VIRTIO_BLK_F_FLUSH) | FEATURE(VIRTIO_BLK_F_CONFIG_WCE) | \
+  FEATURE(VIRTIO_BLK_F_MQ) | FEATURE(VIRTIO_BLK_F_DISCARD) | \
+  FEATURE(VIRTIO_BLK_F_WRITE_ZEROES))
+
+//请求的初始化，操作系统启动时，main()函数会调用该函数进行初始化，初始化函数中会初始化各队列的锁，设定磁盘中断控制，并检查是否存在第二个磁盘。
+void
+virtio_disk_init(void)
+{
+  uint32 status = 0;
 
-  //红黑树
-  RBTree tree[2];
+  disk.version = *R(VIRTIO_MMIO_VERSION);
+  if(*R(VIRTIO_MMIO_MAGIC_VALUE) != 0x74726976 ||
+     (disk.version != 1 && disk.version != 2) ||
+     *R(VIRTIO_MMIO_DEVICE_ID) != 2 ||
+     *R(VIRTIO_MMIO_VENDOR_ID) != 0x554d4551){
+    panic("could not find virtio disk");
+  }
 
-  Ring ring[2];
+  status |= VIRTIO_CONFIG_S_ACKNOWLEDGE;
+  *R(VIRTIO_MMIO_STATUS) = status;
 
-  struct req readyArea;
+  status |= VIRTIO_CONFIG_S_DRIVER;
+  *R(VIRTIO_MMIO_STATUS) = status;
 
-  
-} __attribute__ ((aligned (PGSIZE))) disk;
+  // negotiate features. a version 2 device has 64 bits of
+  // them, 32 at a time. accept only the offered features this
+  // driver implements; anything else (e.g. NOTIFICATION_DATA)
+  // would change what the device expects of us.
+  uint64 features = *R(VIRTIO_MMIO_DEVICE_FEATURES);
+  if(disk.version == 2){
+    *R(VIRTIO_MMIO_DEVICE_FEATURES_SEL) = 1;
+    features |= (uint64)*R(VIRTIO_MMIO_DEVICE_FEATURES) << 32;
+    *R(VIRTIO_MMIO_DEVICE_FEATURES_SEL) = 0;
+  }
+  features &= DRIVER_FEATURES;
+  // a packed ring is only used with indirect descriptors, so
+  // that every request is one descriptor of the ring.
+  if(!(features & (1 << VIRTIO_RING_F_INDIRECT_DESC)))
+    features &= ~((uint64)1 << VIRTIO_F_RING_PACKED);
+  if(disk.version == 2){
+    if(!(features & ((uint64)1 << VIRTIO_F_VERSION_1)))
+      panic("virtio disk: no VIRTIO_F_VERSION_1");
+    *R(VIRTIO_MMIO_DRIVER_FEATURES_SEL) = 1;
+    *R(VIRTIO_MMIO_DRIVER_FEATURES) = features >> 32;
+    *R(VIRTIO_MMIO_DRIVER_FEATURES_SEL) = 0;
+  }
+  *R(VIRTIO_MMIO_DRIVER_FEATURES) = features;
+  disk.event_idx = (features & (1 << VIRTIO_RING_F_EVENT_IDX)) != 0;
+  disk.indirect = (features & (1 << VIRTIO_RING_F_INDIRECT_DESC)) != 0;
+  disk.packed = (features & ((uint64)1 << VIRTIO_F_RING_PACKED)) != 0;
 
+  // tell device that feature negotiation is complete.
+  status |= VIRTIO_CONFIG_S_FEATURES_OK;
+  *R(VIRTIO_MMIO_STATUS) = status;
 
-//cfq算法
-void insertMinHeap(MinHeap heap, struct req x){
-    //判断是否满了 
-    if (heap->Size == heap->Capacity){
-        panic("queue out of capacity");
-    }
+  // a version 2 device may refuse the features we chose.
+  if(disk.version == 2 && !(*R(VIRTIO_MMIO_STATUS) & VIRTIO_CONFIG_S_FEATURES_OK))
+    panic("virtio disk FEATURES_OK unset");
+
+  // run the cache in write-back mode, if it can be flushed:
+  // log commits flush it where order matters, and the other
+  // writes finish as soon as the device has them. without
+  // CONFIG_WCE a device that offers FLUSH is write-back already.
+  if(features & (1 << VIRTIO_BLK_F_FLUSH)){
+    volatile uint8 *wb = (volatile uint8 *)(VIRTIO0 + VIRTIO_MMIO_CONFIG + VIRTIO_BLK_CONFIG_WRITEBACK);
+    if(features & (1 << VIRTIO_BLK_F_CONFIG_WCE))
+      *wb = 1;
+    disk.cached = !(features & (1 << VIRTIO_BLK_F_CONFIG_WCE)) || *wb == 1;
+  }
 
-    int p = ++heap->Size;
-    //printf("dafda%d\n",p);
-    for (; heap->data[p/2].b->blockno>x.b->blockno; p/=2) {
-//这里是最小堆  所以在a[0]位置的岗哨保存了比数组中所有元素都小的元素
-        heap->data[p] = heap->data[p/2];
-        //printf("dafda%d\n",p);
-    }
+  if(features & (1 << VIRTIO_BLK_F_DISCARD)){
+    uint32 max = *(volatile uint32 *)(VIRTIO0 + VIRTIO_MMIO_CONFIG + VIRTIO_BLK_CONFIG_MAX_DISCARD_SECTORS);
+    disk.maxdiscard = max / (BSIZE / 512);
+  }
+  if(features & (1 << VIRTIO_BLK_F_WRITE_ZEROES)){
+    uint32 max = *(volatile uint32 *)(VIRTIO0 + VIRTIO_MMIO_CONFIG + VIRTIO_BLK_CONFIG_MAX_WRITE_ZEROES_SECTORS);
+    disk.maxzeroes = max / (BSIZE / 512);
+  }
 
-    heap->data[p] = x;
-    
-}
+  // one virtqueue per hart, if the device has that many.
+  disk.nq = 1;
+  if(features & (1 << VIRTIO_BLK_F_MQ)){
+    disk.nq = *(volatile uint16 *)(VIRTIO0 + VIRTIO_MMIO_CONFIG + VIRTIO_BLK_CONFIG_NUM_QUEUES);
+    if(disk.nq > NVQ)
+      disk.nq = NVQ;
+    if(disk.nq < 1)
+      disk.nq = 1;
+  }
 
-void deleteFromMinHeap(MinHeap heap) {
-    //struct req top = heap->data[1];
-    struct req last = heap->data[heap->Size--];
-    int parent, child;
-    for (parent = 1; parent * 2 <= heap->Size; parent = child) {
-        child = parent * 2;
-        //注意这里是存在右子节点 并且 右子节点比左子节点小    
-        if (child != heap->Size && heap->data[child].b->blockno > heap->data[child + 1].b->blockno) {
-            child++;
-        }
-        //如果比右子节点还小
-        if (heap->data[child].b->blockno > last.b->blockno) {
-            break;
-        }
-        else {//下滤
-            heap->data[parent] = heap->data[child];
-        }
-      
+  if(disk.version == 1)
+    *R(VIRTIO_MMIO_GUEST_PAGE_SIZE) = PGSIZE;
+
+  for(int q = 0; q < disk.nq; q++){
+    struct virtq *vq = &disk.q[q];
+
+    initlock(&vq->lock, "virtio_disk");
+
+    // initialize queue q.
+    *R(VIRTIO_MMIO_QUEUE_SEL) = q;  //被选中队列，只写
+    if(disk.version == 2 && *R(VIRTIO_MMIO_QUEUE_READY))
+      panic("virtio disk should not be ready");
+    uint32 max = *R(VIRTIO_MMIO_QUEUE_NUM_MAX); //队列容量，只读
+    if(max == 0)
+      panic("virtio disk has no queue");
+    if(max < NUM) //队列容量必须大于指示符数量
+      panic("virtio disk max queue too short");
+    *R(VIRTIO_MMIO_QUEUE_NUM) = NUM;  //当前队列大小
+    memset(vq->pages, 0, sizeof(vq->pages));  //先将页面初始化
+
+    // desc = pages -- num * virtq_desc
+    // avail = pages + 0x40 -- 2 * uint16, then num * uint16
+    // used = pages + 4096 -- 2 * uint16, then num * vRingUsedElem
+    //PGSIZE 4096bytes，desc为8*16=1024
+
+    vq->desc = (struct virtq_desc *) vq->pages;
+    vq->avail = (struct virtq_avail *)(vq->pages + NUM*sizeof(struct virtq_desc));
+    vq->used = (struct virtq_used *) (vq->pages + PGSIZE);
+
+    // ring = pages -- num * pvirtq_desc
+    // driver_event = pages + num * pvirtq_desc
+    // device_event = pages + 4096
+    vq->ring = (struct pvirtq_desc *) vq->pages;
+    vq->driver_event = (struct pvirtq_event_suppress *)(vq->pages + NUM*sizeof(struct pvirtq_desc));
+    vq->device_event = (struct pvirtq_event_suppress *) (vq->pages + PGSIZE);
+    vq->pub_wrap = vq->used_wrap = 1;
+
+    if(disk.version == 1){
+      *R(VIRTIO_MMIO_QUEUE_PFN) = ((uint64)vq->pages) >> PGSHIFT;
+    } else {
+      // the three areas, wherever they are; for a packed ring
+      // they are the ring and the two event suppressions.
+      uint64 desc = (uint64) vq->desc;
+      uint64 driver = disk.packed ? (uint64) vq->driver_event : (uint64) vq->avail;
+      uint64 device = disk.packed ? (uint64) vq->device_event : (uint64) vq->used;
+      *R(VIRTIO_MMIO_QUEUE_DESC_LOW) = desc;
+      *R(VIRTIO_MMIO_QUEUE_DESC_HIGH) = desc >> 32;
+      *R(VIRTIO_MMIO_DRIVER_DESC_LOW) = driver;
+      *R(VIRTIO_MMIO_DRIVER_DESC_HIGH) = driver >> 32;
+      *R(VIRTIO_MMIO_DEVICE_DESC_LOW) = device;
+      *R(VIRTIO_MMIO_DEVICE_DESC_HIGH) = device >> 32;
+      *R(VIRTIO_MMIO_QUEUE_READY) = 1;
     }
-    heap->data[parent] = last;
-    return;
-}
-
-
-
-
-
-
-
-
-
-
 
+    vreq_init(vq);
+  }
 
-uint64
-Nowtime(void)
-{
-  uint xticks;
+  // tell device we're completely ready.
+  status |= VIRTIO_CONFIG_S_DRIVER_OK;
+  *R(VIRTIO_MMIO_STATUS) = status;
 
-  acquire(&tickslock);
-  xticks = ticks;
-  release(&tickslock);
-  return xticks;
+  // plic.c and trap.c arrange for interrupts from VIRTIO0_IRQ.
 }
 
-
-//sstf算法
-struct Queue {//创建一个队列，该队列存放缓存区送来的IO请求
-	struct req data[128];
-	int size;
-	int capacity;
-};
-
-struct Queue sstfqnode;
-struct Queue* sstfq;
-
-int distance(struct req x,struct req y)
+// the virtqueue of the hart r was submitted on.
+static struct virtq*
+reqvq(struct req *r)
 {
-	int delta = x.b->blockno - y.b->blockno;
-	if(delta>=0)
-		return delta;
-	else{
-		delta = - delta;
-		return delta;
-	}
+  return &disk.q[r->cpu % disk.nq];
 }
 
-void SSTF(struct Queue* qp)//SSTF算法实现，头尾指针改变
+// link the descriptor chains of vq's request objects and put
+// them all on the free stack.
+static void
+vreq_init(struct virtq *vq)
 {
-	for(int i=1 ;i< qp->size; i++)
-	{
-		if (distance(qp->data[0], qp->data[i]) < distance(qp->data[0], qp->data[1])){
-			struct req cur = qp->data[i];
-			qp->data[i] = qp->data[1];
-			qp->data[1] = cur;
+  vq->stride = disk.indirect ? 1 : MAXSEG+2;
+  vq->nvreq = NUM / vq->stride;
+  vq->nfree = 0;
+  for(int i = vq->nvreq - 1; i >= 0; i--){
+    struct vreq *v = &vq->vreq[i];
+
+    v->head = i * vq->stride;
+    v->r = 0;
+    vq->freevreq[vq->nfree++] = i;
+
+    // a packed ring's indirect table is read in order, without
+    // next fields; its status descriptor follows the last data
+    // one, so only the header is fixed.
+    if(disk.packed){
+      v->pd = (struct pvirtq_desc *) vq->indirect[i];
+      v->pd[0].addr = (uint64) &v->hdr;
+      v->pd[0].len = sizeof(struct virtio_blk_req);
+      v->pd[0].flags = 0;
+      continue;
     }
-	}
-}
-
 
-void enqueue(struct Queue* qp,struct req x){
-	if (qp->size == qp->capacity){
-        panic("queue out of capacity");
+    if(disk.indirect){
+      v->d = vq->indirect[i];
+      v->base = 0;   // next is an index into the table
+      vq->desc[v->head].addr = (uint64) v->d;
+      vq->desc[v->head].len = (MAXSEG+2) * sizeof(struct virtq_desc);
+      vq->desc[v->head].flags = VRING_DESC_F_INDIRECT;
+      vq->desc[v->head].next = 0;
+    } else {
+      v->d = &vq->desc[v->head];
+      v->base = v->head;
     }
-	qp->data[qp->size++] = x;
-	SSTF(qp);
-}
-
 
-void dequeue(struct Queue* qp){
-	//if ( x>size-1 || x<0)
-		//panic("queue overflow");
-	for(int i=0 ; i<qp->size-1; i++)//有无问题
-		qp->data[i]=qp->data[i+1];
-	qp->size--;
-	SSTF(qp);
+    // 第一个描述符表示格式
+    v->d[0].addr = (uint64) &v->hdr;
+    v->d[0].len = sizeof(struct virtio_blk_req);
+    v->d[0].flags = VRING_DESC_F_NEXT;
+    v->d[0].next = v->base + 1;
+    //最后一个描述符为1个单字节状态
+    v->d[MAXSEG+1].addr = (uint64) &v->status;
+    v->d[MAXSEG+1].len = 1;
+    v->d[MAXSEG+1].flags = VRING_DESC_F_WRITE; // device writes the status
+    v->d[MAXSEG+1].next = 0;
+  }
 }
 
+// how many more full-sized requests surely fit, so
+// blk_dispatch() never overfills a virtqueue. the elevator picks
+// the request, and with it the virtqueue, only afterwards, so
+// this is the room in the fullest one. called with queue_lock held.
+int
+virtio_disk_room(void)
+{
+  int n = NUM;
 
-
-
-
-
-//ddl
-void
-Rotate(Node* node, int dir) { //when dir == 0, left rotate, otherwise right
-    Node* newP = node->p[1 - dir];
-    if (node == node->p[2]->p[0]) {
-        node->p[2]->p[0] = newP;
-    }
-    else {
-        node->p[2]->p[1] = newP;
-    }
-    newP->p[2] = node->p[2];        //rearrange the new father
-    node->p[1 - dir] = newP->p[dir];
-    newP->p[1 - dir]->p[2] = newP; //rearrange the grandson
-    node->p[2] = newP;
-    newP->p[dir] = node; //rearrange the node itself
+  for(struct virtq *vq = disk.q; vq < &disk.q[disk.nq]; vq++){
+    acquire(&vq->lock);
+    if(vq->nfree < n)
+      n = vq->nfree;
+    release(&vq->lock);
+  }
+  return n;
 }
 
+//磁盘读写
+// put r on its hart's virtqueue without waiting for it;
+// the device sees it after the next virtio_disk_kick(), and
+// the completion arrives in virtio_disk_intr().
+// called with queue_lock held, possibly from an interrupt,
+// so it must not sleep: blk_dispatch() only calls it when
+// virtio_disk_room() says the request fits.
 void
-BalanceAfterAddition(Node* node, RBTree* tree) {
-    while (node->p[2]->color == RED) {
-        Node* p = node->p[2], * g = node->p[2]->p[2];
-        int dir = 1;
-        if (p == g->p[0]) {
-            dir = 0;
-        }
-        Node* u = g->p[1 - dir];
-        if (u->color == RED) {
-            p->color = BLACK;
-            u->color = BLACK;
-            g->color = RED;
-            node = g;
-        }
-        else if (node == p->p[1]) {
-            node = p;
-            Rotate(node, dir); //when dir == 0, left rotate, otherwise right  
-       }
-        else {
-            p->color = BLACK;
-            g->color = RED;
-            Rotate(g, 1 - dir);
-        }
-    }
-    if (tree->root != NULL)
-        tree->root->color = BLACK;
-}
-
-void BalanceAfterDeletion(Node* temp, RBTree* tree) {
-    int dir = 0;
-    for (; ; dir++) {
-        if (temp->p[dir] == NULL) //reveal the direction of node deletion
-            break;
-    }
-    if (temp->p[2] == &tree->sen || temp->p[2]->color == RED) {
-        temp->color = BLACK;
-        return;
-    }
-    Node* p = temp->p[2], * b = p->p[1 - dir], * cin = b->p[dir], * cout = b->p[1 - dir];
-    if (b->color == BLACK) { //parent, brother, inner consin and outer cousin
-        if (cin != NULL && cout == NULL) {
-            cin->color = BLACK;
-            b->color = RED;
-            Rotate(b, 1 - dir);
-            cout = b;
-            b = cin;
-            cin = NULL;
-        }
-        if (cout != NULL) {
-            b->color = p->color;
-            cout->color = BLACK;
-            p->color = BLACK; 
-            Rotate(p, dir);
-        }
-        else {
-            p->color = BLACK;
-            b->color = RED;
-            BalanceAfterDeletion(p, tree);
-        }
-    }    
-    else {
-        b->color = BLACK;
-        cin->color = RED;
-        Rotate(p, dir); //four different situations after the deletion
-    }
-}
-
-struct req GetFromRBTree(RBTree* tree) {
-    if (tree == &disk.tree[0] && tree->size == 0) {
-        return GetFromRBTree(&disk.tree[1]);  //delete from tree[1] only if tree[0] is empty
-    }
-    Node* temp = &tree->sen;
-    while (temp->p[0] != NULL) {
-        temp = temp->p[0];
-    } //reach the mininum of the nodes
-    return temp->data;
-}
+virtio_disk_start(struct req *r)
+{
+  struct virtq *vq = reqvq(r);
+  int write = r->write;
+  uint64 sector = r->blockno * (BSIZE / 512); //扇区=块号*2
 
-void PrimRBTree(RBTree* tree) {
-    if (tree == &disk.tree[0] && tree->size == 0) {
-        PrimRBTree(&disk.tree[1]);           //delete from tree[1] only if tree[0] is empty
-        return;
-    }
-    else if (tree->size != 0) {
-        tree->size--;
-    }
-    Node* temp = &tree->sen;
-    while (temp->p[0] != NULL) {
-        temp = temp->p[0];
-    }
-    tree->pos++;
-    tree->avail[tree->pos] = temp->rank;//delete and free the node
-    temp->p[2]->p[0] = NULL;
-    Section* pSection = temp->pSection; //delete and free the corresponding section in the ring
-    Ring* pRing = disk.ring + temp->data.write;
-    pRing->pos++;
-    pRing->avail[pRing->pos] = pSection->rank;        
-    pRing->size--;
-    pSection->pFront->pBack = pSection->pBack;
-    if(pSection->pBack != NULL)
-        pSection->pBack->pFront = pSection->pFront;
-    if (temp->p[1] != NULL) {
-        temp->p[2]->p[0] = temp->p[1];
-    }
-    else {
-        BalanceAfterDeletion(temp, tree);
-    }
-}
+  acquire(&vq->lock);
 
-void DeleteFromRBTree(Node* node, RBTree* tree) {
-    int dir = 0;
-    for (; ; dir++) 
-        if (node->p[2]->p[dir] == node)
-            break; //searching
-    node->p[2]->p[dir] = NULL;
-    tree->pos++;
-    tree->avail[tree->pos] = node->rank;//deletion and freeing
-    node->p[2]->p[0] = NULL;
-    BalanceAfterDeletion(node->p[2], tree); //rebalance
-}
+  // the spec's Section 5.2 says that legacy block operations use
+  // one descriptor for type/reserved/sector, then the data, then
+  // one for a 1-byte status result. the data may span several
+  // descriptors, one per block of the request. a vreq has all
+  // of them linked already.
+  if(vq->nfree == 0)
+    panic("virtio_disk_start: no request objects");
+  struct vreq *v = &vq->vreq[vq->freevreq[--vq->nfree]];
+  int head = v->head;
 
-Section* InsertToRing(Ring* ring,struct req x) {
-    if (ring->size == ring->capacity) {
-        panic("ring out of capacity");
-    }
-    ring->size++;
-    Section* pSection= ring->section + ring->avail[ring->pos];
-    ring->pos--;
-    pSection->data = x;
-    pSection->time = Nowtime();
-    pSection->pFront = ring->rear;
-    ring->rear->pBack = pSection;
-    ring->rear = pSection;
-    return pSection;
-}
+  // qemu's virtio-blk.c reads them.
+  if(r->cmd == REQ_CMD_FLUSH)
+    v->hdr.type = VIRTIO_BLK_T_FLUSH; // no data; sector is 0
+  else if(r->cmd == REQ_CMD_DISCARD)
+    v->hdr.type = VIRTIO_BLK_T_DISCARD; // data is the range
+  else if(r->cmd == REQ_CMD_WZEROES)
+    v->hdr.type = VIRTIO_BLK_T_WRITE_ZEROES; // so is this one
+  else if(write)
+    v->hdr.type = VIRTIO_BLK_T_OUT; // write the disk
+  else
+    v->hdr.type = VIRTIO_BLK_T_IN; // read the disk
+  v->hdr.reserved = 0;
+  v->hdr.sector = sector;
+
+  // the data descriptors: one per block, or the range of a
+  // discard or write-zeroes, which the device reads.
+  int ndata = r->nseg;
+  uint64 addr[MAXSEG];
+  uint32 len[MAXSEG];
+  for(int i = 0; i < r->nseg; i++){
+    addr[i] = (uint64) r->seg[i]->data;
+    len[i] = BSIZE;
+  }
+  if(r->cmd == REQ_CMD_DISCARD || r->cmd == REQ_CMD_WZEROES){
+    v->hdr.sector = 0;
+    v->range.sector = sector;
+    v->range.num_sectors = r->count * (BSIZE / 512);
+    v->range.flags = 0;
+    addr[0] = (uint64) &v->range;
+    len[0] = sizeof(v->range);
+    ndata = 1;
+  }
 
-void RenewReadyArea() {
-    for (int i = 0; i < 2; i++) {
-        uint64 timecost = 0;
-        Ring* pRing = &disk.ring[i];  //following the order of read queue, write queue, 
-        if (pRing->sen.pBack != NULL) //read RB tree and write Rb tree
-            if ((timecost = (Nowtime() - pRing->sen.pBack->time)) > pRing->timeLimit) {
-                disk.readyArea = pRing->sen.pBack->data;
-                DeleteFromRBTree(pRing->sen.pBack->pNode, disk.tree + pRing->sen.pBack->data.write);
-                pRing->size--;
-                pRing->pos++;
-                pRing->avail[pRing->pos] = pRing->sen.pBack->rank;
-                pRing->sen.pBack = pRing->sen.pBack->pBack;
-                pRing->sen.pBack->pFront = &pRing->sen;
-             }  //selective information
-                //printf("timecost: %d\n", timecost);
-    }
-    disk.readyArea = GetFromRBTree(&disk.tree[0]);
-}
+  if(disk.packed){
+    struct pvirtq_desc *pd = v->pd;
+    int n = ndata + 2;
 
-Node* InsertToRBTree(RBTree* tree, struct req x) {
-    if(tree->size == tree->capacity) {
-        panic("queue out of capacity");
+    for(int i = 1; i <= ndata; i++){
+      pd[i].addr = addr[i-1];
+      pd[i].len = len[i-1];
+      pd[i].flags = write ? 0 : VRING_DESC_F_WRITE;
     }
-    tree->size++;
-    Node* hot = &tree->sen;
-    Node* tmp = tree->root;
-    int dir = 0;
-    while (tmp != NULL) {
-        hot = tmp;
-        if (tmp->data.b->blockno > x.b->blockno) {
-            dir = 0;
-            tmp = tmp->p[0];
-        }
-        else {
-            dir = 1;
-            tmp = tmp->p[1];
-        }
+    pd[n-1].addr = (uint64) &v->status;
+    pd[n-1].len = 1;
+    pd[n-1].flags = VRING_DESC_F_WRITE;
+
+    // fill in the next ring slot; virtio_disk_kick() sets its
+    // flags, which is what makes it available.
+    struct pvirtq_desc *slot = &vq->ring[vq->avail_pos];
+    slot->addr = (uint64) pd;
+    slot->len = n * sizeof(struct pvirtq_desc);
+    slot->id = v - vq->vreq;
+    vq->avail_pos = (vq->avail_pos + 1) % NUM;
+  } else {
+    for(int i = 1; i <= ndata; i++){
+      v->d[i].addr = addr[i-1];  //地址为块
+      v->d[i].len = len[i-1];
+      if(write)
+        v->d[i].flags = VRING_DESC_F_NEXT; // device reads b->data
+      else
+        v->d[i].flags = VRING_DESC_F_WRITE | VRING_DESC_F_NEXT; // device writes b->data
+      v->d[i].next = v->base + (i == ndata ? MAXSEG+1 : i+1);
     }
-    tmp = tree->node + tree->avail[tree->pos];
-    tree->pos--;
-    tmp->color = RED;
-    tmp->data = x;
-    tmp->p[2] = hot;  //initiation of the newly inserted nodes
-    hot->p[dir] = tmp;
-    if (hot == &tree->sen) {
-        tmp->color = BLACK;    
-    }
-    else {
-        hot->p[1] = tmp;
-    }
-    BalanceAfterAddition(tmp, tree);
-    RenewReadyArea();
-    return tmp;//return the pointer for the link between nodes and sections
-}
-
-
-
-
-
-
-
-
-//调度函数
-void rw_queue(struct buf*b,int write){
-  if(IO_type==0){
-    //printf("io-0");
-    virtio_disk_rw(b, write);
+    // a request without data goes from header to status.
+    v->d[0].next = v->base + (ndata > 0 ? 1 : MAXSEG+1);
+
+    // tell the device the first index in our chain of descriptors.
+    // the device cannot see the entry until virtio_disk_kick()
+    // moves avail->idx past it.
+    //告诉磁盘队列中等待的请求的第一个描述符
+    vq->avail->ring[(vq->avail->idx + vq->staged) % NUM] = head;
   }
-  else if (IO_type==1){
-    //printf("io-1");
-    acquire(&queue_lock);
-    struct req r;
-    //printf("test2");
-    r.b=b;
-    r.write=write;
-//printf("test3");
-    
-//printf("test4");
-    insertMinHeap(disk.heap,r);
-    
-    //printf("队列长度%d\n",disk.heap->Size);
-    release(&queue_lock);
-    virtio_disk_rw(disk.heap->data[1].b, disk.heap->data[1].write);
-    
-    //if(disk.heap->Size>2){
-    //  printf("合并情况");
-    //  
-    //  for(int i=1;i<=disk.heap->Size;i++){
-    //    virtio_disk_rw(disk.heap->data[i].b, disk.heap->data[i].write);
-    //  }
-//
-    //}
-    //else{
-    //  uint64 begin=Nowtime();
-    //  uint64 end=Nowtime();
-    //  while(end-begin<1){
-    //    end=Nowtime();
-    //  }
-    //  printf("队列长度%d\n",disk.heap->Size);
-    //  for(int i=1;i<=disk.heap->Size;i++){
-    //    //printf("%d\n",disk.heap->data[i].b->blockno);
-    //    virtio_disk_rw(disk.heap->data[i].b, disk.heap->data[i].write);
-    //  }
-//
-    //}
-    //
-  }
-  else if(IO_type==2){
-    acquire(&queue_lock);
-    struct req r;
-    r.b=b;
-    r.write=write;
-    enqueue(sstfq,r);
-    release(&queue_lock);
-    virtio_disk_rw(sstfq->data[0].b, sstfq->data[0].write);
-  }
-  else if(IO_type==3){
-    acquire(&queue_lock);
-    struct req r;
-    r.b=b;
-    r.write=write;
-    Section* pSection = InsertToRing(&disk.ring[write], r);
-    Node* pNode = InsertToRBTree(&disk.tree[write], r);
-    pSection->pNode = pNode;
-    pNode->pSection = pSection;
-    release(&queue_lock);
-    virtio_disk_rw(disk.readyArea.b, disk.readyArea.write);
-  }
-  
- 
-}
+  v->status = 0xff; // device writes 0 on success 设备成功写入0
 
+  // record the request for virtio_disk_intr().
+  v->r = r;
+  vq->staged++;
 
+  release(&vq->lock);
+}
 
+// does the device want to be notified of the avail entries
+// from old up to new?
+static int
+need_notify(struct virtq *vq, uint16 old, uint16 new)
+{
+  if(!disk.packed)
+    return !disk.event_idx || VRING_NEED_EVENT(vq->used->avail_event, new, old);
+
+  // a packed ring's device event is a slot and wrap counter;
+  // one from the previous lap counts from NUM slots back.
+  uint16 flags = vq->device_event->flags;
+  if(flags != VRING_PACKED_EVENT_FLAG_DESC)
+    return flags != VRING_PACKED_EVENT_FLAG_DISABLE;
+  uint16 off_wrap = vq->device_event->off_wrap;
+  uint16 event = off_wrap & 0x7fff;
+  if((off_wrap >> 15) != vq->pub_wrap)
+    event -= NUM;
+  return VRING_NEED_EVENT(event, new, old);
+}
 
-//请求的初始化，操作系统启动时，main()函数会调用该函数进行初始化，初始化函数中会初始化vdisk_lock锁，设定磁盘中断控制，并检查是否存在第二个磁盘。
+// publish the requests virtio_disk_start() has put in the avail
+// rings since the last call: one avail->idx update, one pair of
+// barriers and at most one notify per queue, however many there
+// are. called with queue_lock held after a round of starts.
 void
-virtio_disk_init(void)
+virtio_disk_kick(void)
 {
-  uint32 status = 0;
-
-  initlock(&disk.vdisk_lock, "virtio_disk");
-  initlock(&queue_lock, "queue_lock");
-
-  if(*R(VIRTIO_MMIO_MAGIC_VALUE) != 0x74726976 ||
-     *R(VIRTIO_MMIO_VERSION) != 1 ||
-     *R(VIRTIO_MMIO_DEVICE_ID) != 2 ||
-     *R(VIRTIO_MMIO_VENDOR_ID) != 0x554d4551){
-    panic("could not find virtio disk");
-  }
-  
-  status |= VIRTIO_CONFIG_S_ACKNOWLEDGE;
-  *R(VIRTIO_MMIO_STATUS) = status;
-
-  status |= VIRTIO_CONFIG_S_DRIVER;
-  *R(VIRTIO_MMIO_STATUS) = status;
-
-  // negotiate features
-  uint64 features = *R(VIRTIO_MMIO_DEVICE_FEATURES);
-  features &= ~(1 << VIRTIO_BLK_F_RO);
-  features &= ~(1 << VIRTIO_BLK_F_SCSI);
-  features &= ~(1 << VIRTIO_BLK_F_CONFIG_WCE);
-  features &= ~(1 << VIRTIO_BLK_F_MQ);
-  features &= ~(1 << VIRTIO_F_ANY_LAYOUT);
-  features &= ~(1 << VIRTIO_RING_F_EVENT_IDX);
-  features &= ~(1 << VIRTIO_RING_F_INDIRECT_DESC);
-  *R(VIRTIO_MMIO_DRIVER_FEATURES) = features;
+  for(struct virtq *vq = disk.q; vq < &disk.q[disk.nq]; vq++){
+    if(vq->staged == 0)
+      continue;
+    acquire(&vq->lock);
+    __sync_synchronize();
 
-  // tell device that feature negotiation is complete.
-  status |= VIRTIO_CONFIG_S_FEATURES_OK;
-  *R(VIRTIO_MMIO_STATUS) = status;
+    // tell the device more avail ring entries are available.
+    //告诉设备另一个可用环条目可用。
+    uint16 new;
+    if(disk.packed){
+      for(int i = 0; i < vq->staged; i++){
+        vq->ring[vq->pub_pos].flags = VRING_DESC_F_INDIRECT |
+          vq->pub_wrap << VRING_PACKED_DESC_F_AVAIL |
+          !vq->pub_wrap << VRING_PACKED_DESC_F_USED;
+        if(++vq->pub_pos == NUM){
+          vq->pub_pos = 0;
+          vq->pub_wrap ^= 1;
+        }
+      }
+      new = vq->pub_pos;
+    } else {
+      vq->avail->idx += vq->staged; // not % NUM ...
+      new = vq->avail->idx;
+    }
+    uint16 old = new - vq->staged;
+    vq->inflight += vq->staged;
+    vq->staged = 0;
+    __sync_synchronize();
 
-  // tell device we're completely ready.
-  status |= VIRTIO_CONFIG_S_DRIVER_OK;
-  *R(VIRTIO_MMIO_STATUS) = status;
+    // with EVENT_IDX the device says, through avail_event, which
+    // entry it wants to hear about; if it is still working through
+    // the ring from an earlier kick, it will see these anyway.
+    if(!need_notify(vq, old, new)){
+      __sync_fetch_and_add(&disk.nonotifies, 1);
+    } else {
+      *R(VIRTIO_MMIO_QUEUE_NOTIFY) = vq - disk.q; // value is queue number
+      __sync_fetch_and_add(&disk.notifies, 1);
+    }
 
-  *R(VIRTIO_MMIO_GUEST_PAGE_SIZE) = PGSIZE;
-
-  // initialize queue 0.
-  *R(VIRTIO_MMIO_QUEUE_SEL) = 0;  //被选中队列，只写
-  uint32 max = *R(VIRTIO_MMIO_QUEUE_NUM_MAX); //队列容量，只读
-  if(max == 0)
-    panic("virtio disk has no queue 0");
-  if(max < NUM) //队列容量必须大于指示符数量
-    panic("virtio disk max queue too short");
-  *R(VIRTIO_MMIO_QUEUE_NUM) = NUM;  //当前队列大小
-  memset(disk.pages, 0, sizeof(disk.pages));  //先将页面初始化
-  *R(VIRTIO_MMIO_QUEUE_PFN) = ((uint64)disk.pages) >> PGSHIFT;
-
-  // desc = pages -- num * virtq_desc
-  // avail = pages + 0x40 -- 2 * uint16, then num * uint16
-  // used = pages + 4096 -- 2 * uint16, then num * vRingUsedElem
-  //PGSIZE 4096bytes，desc为8*16=1024
-
-  disk.desc = (struct virtq_desc *) disk.pages;
-  //printf("1:%x\n",disk.desc);
-  disk.avail = (struct virtq_avail *)(disk.pages + NUM*sizeof(struct virtq_desc));
-  //printf("2:%x\n",disk.avail);
-  //printf("2:%x\n",sizeof(struct virtq_desc));
-  disk.used = (struct virtq_used *) (disk.pages + PGSIZE);
-  //printf("3:%x\n",disk.used);
-
-  // all NUM descriptors start out unused.
-  for(int i = 0; i < NUM; i++)
-    disk.free[i] = 1;
-
-
-  //最小堆
- 
-  disk.heap=(MinHeap) &disk.hnode;
-  //printf("1213421341\n");
-  disk.heap->Size = 0;
-  disk.heap->Capacity=128;
-  
-  r.write=0;
-  temp.blockno=0;
-  r.b=&temp;
-  disk.heap->data[0] = r;//岗哨 
-
-
-
-  //sstf
-
-  sstfq=&sstfqnode;
-  sstfq->capacity=128;
-  sstfq->size=0;
-
-
-
-  //ddl
-  int i, j;
-  for (i = 0; i < 2; i++) {
-      disk.tree[i].root = NULL;
-      disk.tree[i].sen.p[0] = NULL;
-      disk.tree[i].sen.color = BLACK;
-      disk.tree[i].size = 0;
-      disk.tree[i].capacity = TREESIZE;
-      for (j = 0; j < TREESIZE; j++) {
-          disk.tree->avail[j] = j;
-      }
-      disk.tree[i].pos = TREESIZE - 1;
-      disk.ring[i].head = &disk.ring[i].sen;
-      disk.ring[i].rear = &disk.ring[i].sen;
-      disk.ring[i].timeLimit = 22;
-      disk.ring[i].size = 0;
-      disk.ring[i].capacity= TREESIZE;
-      for (j = 0; j < TREESIZE; j++) {
-          disk.ring->avail[j] = j;
-      }
-      disk.ring[i].pos = TREESIZE - 1;
+    release(&vq->lock);
   }
-  // plic.c and trap.c arrange for interrupts from VIRTIO0_IRQ.
 }
 
-// find a free descriptor, mark it non-free, return its index.
-//找到一个描述符，标记其为不空闲，返回其索引（顺着找）
+// has the device used another chain of vq?
 static int
-alloc_desc()
+used_ready(struct virtq *vq)
 {
-  for(int i = 0; i < NUM; i++){
-    if(disk.free[i]){
-      disk.free[i] = 0;
-      return i;
-    }
+  if(disk.packed){
+    uint16 f = *(volatile uint16 *)&vq->ring[vq->used_pos].flags;
+    int avail = (f >> VRING_PACKED_DESC_F_AVAIL) & 1;
+    int used = (f >> VRING_PACKED_DESC_F_USED) & 1;
+    return avail == used && used == vq->used_wrap;
   }
-  return -1;
+  return vq->used_idx != *(volatile uint16 *)&vq->used->idx;
 }
 
-// mark a descriptor as free.
-//标记一个描述符为空闲
-static void
-free_desc(int i)
+// the vreq of the next chain the device used; move past it.
+static struct vreq*
+used_next(struct virtq *vq)
 {
-  if(i >= NUM)  //如果超出NUM范围，报错
-    panic("free_desc 1");
-  if(disk.free[i])  //如果该描述符本身为空闲，报错
-    panic("free_desc 2");
-  disk.desc[i].addr = 0;
-  disk.desc[i].len = 0;
-  disk.desc[i].flags = 0;
-  disk.desc[i].next = 0;
-  disk.free[i] = 1;
-  wakeup(&disk.free[0]);  //唤起被挂起的调用
+  int id;
+
+  __sync_synchronize();
+  if(disk.packed){
+    id = vq->ring[vq->used_pos].id;
+    if(++vq->used_pos == NUM){
+      vq->used_pos = 0;
+      vq->used_wrap ^= 1;
+    }
+  } else {
+    id = vq->used->ring[vq->used_idx % NUM].id / vq->stride;
+    vq->used_idx += 1;
+  }
+  return &vq->vreq[id];
 }
 
-// free a chain of descriptors.
-//释放一个描述符链表的空间
+// with EVENT_IDX, have the device interrupt only once it has
+// used n more chains.
 static void
-free_chain(int i)
+intr_after(struct virtq *vq, int n)
 {
-  while(1){
-    int flag = disk.desc[i].flags;  
-    int nxt = disk.desc[i].next;
-    free_desc(i);
-    if(flag & VRING_DESC_F_NEXT)  //是否valid
-      i = nxt;
-    else
-      break;
+  if(!disk.packed){
+    vq->avail->used_event = vq->used_idx + n - 1;
+    return;
+  }
+  int pos = vq->used_pos + n - 1, wrap = vq->used_wrap;
+  if(pos >= NUM){
+    pos -= NUM;
+    wrap ^= 1;
   }
+  vq->driver_event->off_wrap = pos | wrap << 15;
+  vq->driver_event->flags = VRING_PACKED_EVENT_FLAG_DESC;
 }
 
-// allocate three descriptors (they need not be contiguous).
-// disk transfers always use three descriptors.
-//分配三个描述符（它们不必是连续的）。
-//磁盘传输始终使用三个描述符。
+// collect the finished requests of vq onto *done;
+// return how many.
 static int
-alloc3_desc(int *idx)
+virtq_reap(struct virtq *vq, struct req **done)
 {
-  for(int i = 0; i < 3; i++){
-    idx[i] = alloc_desc();
-    if(idx[i] < 0){ //若申请失败，意味着当前空间不够
-      for(int j = 0; j < i; j++)
-        free_desc(idx[j]);  //释放之前申请的几个描述符，返回申请失败
-      return -1;
+  struct req *r;
+  int n = 0;
+
+  acquire(&vq->lock);
+
+  // the device increments used->idx when it adds an entry to
+  // the used ring, or in a packed ring flips the flags of the
+  // next slot. collect every finished chain, not just one per
+  // interrupt.
+  //当将条目添加到已使用的环中时,该设备增加了used->idx
+  for(;;){
+    while(used_ready(vq)){
+      struct vreq *v = used_next(vq);
+
+      r = v->r;
+      // a discard is only advice; the device may refuse it.
+      if(v->status != 0 && r->cmd != REQ_CMD_DISCARD)
+        panic("virtio_disk_intr status");
+
+      v->r = 0;
+      vq->freevreq[vq->nfree++] = v - vq->vreq;
+      r->pFront = *done;
+      *done = r;
+      vq->inflight--;
+      n++;
     }
-  }
-  return 0;
-}
-
-
-
-//磁盘读写
-void
-virtio_disk_rw(struct buf *b, int write)
-{
-  uint64 sector = b->blockno * (BSIZE / 512); //扇区=块号*2
 
-  acquire(&disk.vdisk_lock);
-
-  // the spec's Section 5.2 says that legacy block operations use
-  // three descriptors: one for type/reserved/sector, one for the
-  // data, one for a 1-byte status result.
-
-  // allocate the three descriptors.
-  //若能申请到三个描述符，继续下一步
-  int idx[3];
-  while(1){
-    if(alloc3_desc(idx) == 0) {
+    // with EVENT_IDX, ask for the next interrupt only after
+    // iotune[IOT_IRQ_BATCH] more completions, or all that are
+    // outstanding if fewer. then look again, in case the device
+    // passed that point before it saw the new event index.
+    if(!disk.event_idx)
+      break;
+    int batch = iotune[IOT_IRQ_BATCH];
+    if(batch > vq->inflight)
+      batch = vq->inflight;
+    if(batch < 1)
+      batch = 1;
+    intr_after(vq, batch);
+    __sync_synchronize();
+    if(!used_ready(vq))
       break;
-    }
-    printf("等待\n");
-    sleep(&disk.free[0], &disk.vdisk_lock); //如果申请不到，进入睡眠状态，当释放描述符时唤醒
-  }
-
-  // format the three descriptors.
-  // qemu's virtio-blk.c reads them.
-
-  struct virtio_blk_req *buf0 = &disk.ops[idx[0]];
-
-  if(write)
-    buf0->type = VIRTIO_BLK_T_OUT; // write the disk
-  else
-    buf0->type = VIRTIO_BLK_T_IN; // read the disk
-  buf0->reserved = 0;
-  buf0->sector = sector;
-
-  // 第一个描述符表示格式
-  disk.desc[idx[0]].addr = (uint64) buf0; //地址为磁盘请求
-  disk.desc[idx[0]].len = sizeof(struct virtio_blk_req);  //表示磁盘请求的长度
-  disk.desc[idx[0]].flags = VRING_DESC_F_NEXT;  //连接下一个描述符
-  disk.desc[idx[0]].next = idx[1];  //下一个描述符为idx[1]
-
-  //第二个描述符用来表示块
-  disk.desc[idx[1]].addr = (uint64) b->data;  //地址为块
-  disk.desc[idx[1]].len = BSIZE;  //长度为块大小
-  if(write)
-    disk.desc[idx[1]].flags = 0; // device reads b->data
-  else
-    disk.desc[idx[1]].flags = VRING_DESC_F_WRITE; // device writes b->data
-  disk.desc[idx[1]].flags |= VRING_DESC_F_NEXT; //读为01，写为11
-  disk.desc[idx[1]].next = idx[2];
-
-  //第三个描述符为1个单字节状态
-  disk.info[idx[0]].status = 0xff; // device writes 0 on success 设备成功写入0
-  disk.desc[idx[2]].addr = (uint64) &disk.info[idx[0]].status; //设备写入状态的地址
-  disk.desc[idx[2]].len = 1;
-  disk.desc[idx[2]].flags = VRING_DESC_F_WRITE; // device writes the status
-  disk.desc[idx[2]].next = 0;
-
-  // record struct buf for virtio_disk_intr().
-  b->disk = 1;  //缓存区内容已经提交给磁盘为0，未完成为1
-  disk.info[idx[0]].b = b;
-
-  // tell the device the first index in our chain of descriptors.
-  //告诉磁盘队列中等待的请求的第一个描述符
-  disk.avail->ring[disk.avail->idx % NUM] = idx[0];
-  //printf("1\n");  
-  __sync_synchronize();
-
-  // tell the device another avail ring entry is available.
-  //告诉设备另一个可用环条目可用。
-  disk.avail->idx += 1; // not % NUM ...
-  //printf("2\n");  
-  __sync_synchronize();
-
-  *R(VIRTIO_MMIO_QUEUE_NOTIFY) = 0; // value is queue number
-
-  // Wait for virtio_disk_intr() to say request has finished.
-  while(b->disk == 1) { //当还没有读取或写入完成时
-    sleep(b, &disk.vdisk_lock);
   }
-  //printf("块号%d\n",disk.info[idx[0]].b->blockno);  
-  disk.info[idx[0]].b = 0;  //跟踪的块信息清零
-  free_chain(idx[0]); //释放这3个描述符
 
-  release(&disk.vdisk_lock);  //释放磁盘锁
+  release(&vq->lock);
+  return n;
 }
 
 void
 virtio_disk_intr()
 {
-  acquire(&disk.vdisk_lock);
+  struct req *done = 0;
 
   // the device won't raise another interrupt until we tell it
   // we've seen this interrupt, which the following line does.
@@ -890,50 +693,69 @@ virtio_disk_intr()
   //完成此中断中的条目，与
   //下一个中断中的条目无关，这是无害的。
   *R(VIRTIO_MMIO_INTERRUPT_ACK) = *R(VIRTIO_MMIO_INTERRUPT_STATUS) & 0x3;
+  __sync_fetch_and_add(&disk.interrupts, 1);
 
   __sync_synchronize();
 
-  // the device increments disk.used->idx when it
-  // adds an entry to the used ring.
-  //当将条目添加到已使用的环中时,该设备增加了disk.used->idx
-  while(disk.used_idx != disk.used->idx){
-    __sync_synchronize();
-    int id = disk.used->ring[disk.used_idx % NUM].id;
-
-    if(disk.info[id].status != 0)
-      panic("virtio_disk_intr status");
-
-    struct buf *b = disk.info[id].b;
-    //printf("首地址字符：%d\n",b->data[0]);
-    b->disk = 0;   // disk is done with buf
-    //printf("4\n");  
-    wakeup(b);
-    //printf("5\n");    
-    disk.used_idx += 1;
-    //printf("已使用idx数目%d\n",disk.used_idx);  //进行测试
-  }
+  // the mmio transport has one interrupt for all virtqueues,
+  // so look at each of them.
+  int n = 0;
+  for(int q = 0; q < disk.nq; q++)
+    n += virtq_reap(&disk.q[q], &done);
+  __sync_fetch_and_add(&disk.intrdone, n);
 
+  // wake the submitters and refill the device.
+  blk_complete(done);
+}
 
+// reap completions without an interrupt, for a submitter
+// polling for its request. a request on any queue may be the
+// one it waits for, so look at all of them.
+void
+virtio_disk_poll(void)
+{
+  struct req *done = 0;
+  int n = 0;
 
+  for(int q = 0; q < disk.nq; q++)
+    if(used_ready(&disk.q[q]))
+      n += virtq_reap(&disk.q[q], &done);
+  if(n == 0)
+    return;
+  __sync_fetch_and_add(&disk.polldone, n);
+  blk_complete(done);
+}
 
-  if(IO_type==1){
-    acquire(&queue_lock);
-    deleteFromMinHeap(disk.heap);
-    release(&queue_lock);
-  }
-  if(IO_type==2){
-    acquire(&queue_lock);
-    dequeue(sstfq);
-    release(&queue_lock);
-  }
-  if(IO_type==3){
-    acquire(&queue_lock);
-    PrimRBTree(&disk.tree[0]); //delete from tree[0], or tree[1] when tree[0] is empty
-    release(&queue_lock);
-  }
- 
-  
+// does the device cache writes, so they need flushing?
+int
+virtio_disk_cached(void)
+{
+  return disk.cached;
+}
 
+// the most blocks one discard may cover; 0 if the device
+// cannot discard.
+int
+virtio_disk_maxdiscard(void)
+{
+  return disk.maxdiscard;
+}
 
-  release(&disk.vdisk_lock);
+// the most blocks one write-zeroes may cover; 0 if the device
+// cannot write zeroes.
+int
+virtio_disk_maxzeroes(void)
+{
+  return disk.maxzeroes;
+}
+
+// add the driver's counters to st.
+void
+virtio_disk_stats(struct iostats *st)
+{
+  st->notifies = disk.notifies;
+  st->nonotifies = disk.nonotifies;
+  st->interrupts = disk.interrupts;
+  st->intrdone = disk.intrdone;
+  st->polldone = disk.polldone;
 }
@@ -0,0 +1,11 @@
+//
+// defs.h for the host build of the elevators (see sim/Makefile):
+// the few kernel services they use, from the C library and
+// from sim.c.
+//
+
+#include <string.h>
+
+void            panic(char*) __attribute__((noreturn));
+
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
@@ -0,0 +1,4 @@
+//
+// riscv.h for the host build of the elevators (see sim/Makefile).
+// they include it only for defs.h; nothing in it is needed.
+//
@@ -0,0 +1,675 @@
+//
+// elvsim: replay a block trace through the kernel's elevators
+// against a model disk, and compare them.
+//
+//   elvsim [-e elevator] [-T param=value]... [-c] [-x scale]
+//          [-r rpm] [-s blocks/track] [-m seek_min] [-M seek_max]
+//          (trace | -g)
+//
+// the trace is blktrace output (user/blktrace.c), e.g. a saved
+// console log; its reads and writes are submitted at their
+// recorded times. with -c a process's reads are closed-loop: each
+// waits for the one before, plus the think time between them in
+// the trace. -g makes up a workload instead: sequential readers
+// and a random writer. -x scales the trace's time.
+//
+// the block layer is cut down to what the elevators see: at most
+// NREQ blocks outstanding (one per buf), merging, and up to
+// iotune[IOT_DEPTH] requests on the device, served in order.
+// the model disk does not reorder, so a deeper device queue only
+// takes the choice away from the elevator: unlike the kernel,
+// depth defaults to 1, and the numbers assume it unless -T
+// depth=N says otherwise. priorities, flushes and discards are
+// left out.
+//
+// the disk has a head that seeks in sqrt(distance) from seek_min
+// to seek_max us, a platter that turns at rpm, and blocks/track
+// blocks per track.
+//
+// for each elevator it reports throughput, read and write latency
+// percentiles (from submission to completion), mean seek distance
+// and Jain's fairness index of the processes' mean latencies.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "types.h"
+#include "param.h"
+#include "iosched.h"
+#include "blk.h"
+
+// one traced block read or write.
+struct rec {
+  uint64 time;     // submitted, us from the start of the trace
+  uint64 odone;    // completed in the trace, or 0 if unknown
+  int pid;
+  int write;
+  int sync;
+  uint blockno;
+};
+
+// a submitted block. its req is the one that goes to the
+// elevator; if that is merged, the block rides in another
+// sreq's req, as seg[i] (just as a buf would).
+struct sreq {
+  struct req r;
+  struct rec *rec;
+  uint64 arrive;
+  struct sreq *next;   // free list
+};
+
+// a process's stream of reads or of writes, in trace order.
+struct stream {
+  int pid;
+  int write;
+  struct rec **recs;
+  int n, next;
+  int waiting;         // closed loop: its last read is outstanding
+  uint64 ready;        // closed loop: when its next read may go
+};
+
+static struct rec *recs;
+static int nrec;
+static struct stream *streams;
+static int nstream;
+
+static int closed;          // -c
+static double scale = 1.0;  // -x
+static int rpm = 7200;
+static int spt = 64;        // blocks per track
+static int seek_min = 500, seek_max = 10000;
+static uint nblocks = FSSIZE;
+
+// indexed by IOSCHED_*, as in blk.c; -e takes either name.
+static struct elevator_ops *elevators[] = {
+[IOSCHED_NOOP]      &noop_ops,
+[IOSCHED_CFQ]       &cfq_ops,
+[IOSCHED_SSTF]      &sstf_ops,
+[IOSCHED_DEADLINE]  &deadline_ops,
+[IOSCHED_CSCAN]     &cscan_ops,
+[IOSCHED_AS]        &as_ops,
+[IOSCHED_BFQ]       &bfq_ops,
+[IOSCHED_KYBER]     &kyber_ops,
+};
+static char *names[NIOSCHED] = IOSCHED_NAMES;
+
+static struct {
+  char *name;
+  int param;
+} params[] = {
+  { "depth", IOT_DEPTH },
+  { "cfq_quantum", IOT_CFQ_QUANTUM },
+  { "cfq_budget", IOT_CFQ_BUDGET },
+  { "maxseg", IOT_MAXSEG },
+  { "read_expire", IOT_DL_READ_EXPIRE },
+  { "write_expire", IOT_DL_WRITE_EXPIRE },
+  { "fifo_batch", IOT_DL_FIFO_BATCH },
+  { "writes_starved", IOT_DL_WRITES_STARVED },
+  { "antic", IOT_AS_ANTIC },
+  { "bfq_budget", IOT_BFQ_BUDGET },
+  { "bfq_timeout", IOT_BFQ_TIMEOUT },
+  { "bfq_idle", IOT_BFQ_IDLE },
+  { "kyber_read_lat", IOT_KY_READ_LAT },
+  { "kyber_sync_lat", IOT_KY_SYNC_LAT },
+  { "kyber_write_lat", IOT_KY_WRITE_LAT },
+};
+
+// the simulation, reset for every elevator.
+static struct {
+  uint64 now;
+  uint64 timer;            // blk_settimer(), or 0
+  struct elevator_ops *elv;
+  int outstanding;         // blocks submitted and not done
+  int queued;              // requests in the elevator
+  struct req *dev[NREQ];   // on the device, in order
+  int ndev;
+  uint64 busy_until;       // the device finishes dev[0]
+  uint head;               // block under the head
+  uint seq;
+  struct sreq *free;
+
+  // results
+  uint64 *lat[2];
+  int nlat[2];
+  uint64 seek;             // blocks the head moved
+  int nseek;
+  int merges;
+  uint64 blocks;
+  double *psum;            // per pid: summed latency
+  int *pcnt;
+} s;
+
+static int maxpid;
+
+void
+panic(char *msg)
+{
+  fprintf(stderr, "elvsim: panic: %s\n", msg);
+  exit(1);
+}
+
+static void
+die(char *msg)
+{
+  fprintf(stderr, "elvsim: %s\n", msg);
+  exit(1);
+}
+
+static void*
+xalloc(size_t n)
+{
+  void *p = calloc(1, n ? n : 1);
+
+  if(p == NULL)
+    die("out of memory");
+  return p;
+}
+
+uint64
+Nowtime(void)
+{
+  return s.now;
+}
+
+void
+blk_settimer(uint64 when)
+{
+  if(s.timer == 0 || when < s.timer)
+    s.timer = when;
+}
+
+static int
+cmp_rec(const void *a, const void *b)
+{
+  const struct rec *x = a, *y = b;
+
+  return x->time < y->time ? -1 : x->time > y->time;
+}
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+  const uint64 *x = a, *y = b;
+
+  return *x < *y ? -1 : *x > *y;
+}
+
+static void
+addrec(struct rec *r, int *cap)
+{
+  if(nrec == *cap){
+    *cap = *cap ? *cap * 2 : 1024;
+    if((recs = realloc(recs, *cap * sizeof(*recs))) == NULL)
+      die("out of memory");
+  }
+  recs[nrec++] = *r;
+}
+
+// read the Q and C events of blktrace output from f.
+static void
+load(FILE *f)
+{
+  char line[256], action, rwbs[8], sched[16];
+  int cpu, pid, cap = 0;
+  uint64 time;
+  uint block, count;
+  struct { uint64 time; uint block, count; } *done = NULL;
+  int ndone = 0, donecap = 0;
+
+  while(fgets(line, sizeof(line), f)){
+    char *p = strstr(line, "bt ");
+    if(p == NULL || sscanf(p, "bt %d %lu %d %c %7s %u %u %15s", &cpu, &time, &pid,
+                           &action, rwbs, &block, &count, sched) != 8)
+      continue;
+    if(action == 'Q' && (rwbs[0] == 'R' || (rwbs[0] == 'W' && rwbs[1] != 'Z'))){
+      struct rec r = { time, 0, pid, rwbs[0] == 'W', strchr(rwbs, 'S') != NULL, block };
+      addrec(&r, &cap);
+    } else if(action == 'C' && rwbs[0] == 'R'){
+      if(ndone == donecap){
+        donecap = donecap ? donecap * 2 : 1024;
+        if((done = realloc(done, donecap * sizeof(*done))) == NULL)
+          die("out of memory");
+      }
+      done[ndone].time = time;
+      done[ndone].block = block;
+      done[ndone].count = count;
+      ndone++;
+    }
+  }
+  if(nrec == 0)
+    die("no reads or writes in the trace");
+  qsort(recs, nrec, sizeof(*recs), cmp_rec);
+
+  // match each traced read to its completion, for -c's think
+  // times: the first completion after it that covers its block.
+  uint maxblock = 0;
+  for(int i = 0; i < nrec; i++)
+    if(recs[i].blockno > maxblock)
+      maxblock = recs[i].blockno;
+  for(int i = 0; i < ndone; i++)
+    if(done[i].block + done[i].count > maxblock)
+      maxblock = done[i].block + done[i].count;
+  int *first = xalloc((maxblock + 1) * sizeof(int));
+  int *last = xalloc((maxblock + 1) * sizeof(int));
+  int *next = xalloc(nrec * sizeof(int));
+  for(uint b = 0; b <= maxblock; b++)
+    first[b] = last[b] = -1;
+  int i = 0;
+  for(int d = 0; d < ndone; d++){
+    for(; i < nrec && recs[i].time <= done[d].time; i++){
+      if(recs[i].write)
+        continue;
+      uint b = recs[i].blockno;
+      next[i] = -1;
+      if(last[b] >= 0)
+        next[last[b]] = i;
+      else
+        first[b] = i;
+      last[b] = i;
+    }
+    for(uint b = done[d].block; b < done[d].block + done[d].count; b++){
+      int k = first[b];
+      if(k < 0)
+        continue;
+      recs[k].odone = done[d].time;
+      if((first[b] = next[k]) < 0)
+        last[b] = -1;
+    }
+  }
+  free(first);
+  free(last);
+  free(next);
+  free(done);
+
+  uint64 t0 = recs[0].time;
+  for(i = 0; i < nrec; i++){
+    recs[i].time = (recs[i].time - t0) * scale;
+    if(recs[i].odone)
+      recs[i].odone = (recs[i].odone - t0) * scale;
+  }
+}
+
+// a made-up workload: four processes reading 256-block files
+// from their own regions of the disk, a block at a time with
+// 200 us of thought in between, and one writing a random block
+// every 20 ms.
+static void
+generate(void)
+{
+  int cap = 0;
+  uint64 seed = 1;
+
+  closed = 1;
+  for(int p = 0; p < 4; p++){
+    for(int i = 0; i < 256; i++){
+      struct rec r = { i * 200, 0, 10 + p, 0, 0, 100 + p * 450 + i };
+      addrec(&r, &cap);
+    }
+  }
+  for(int i = 0; i < 500; i++){
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    struct rec r = { i * 20000, 0, 20, 1, 0, 100 + (uint)(seed >> 33) % (FSSIZE - 100) };
+    addrec(&r, &cap);
+  }
+  qsort(recs, nrec, sizeof(*recs), cmp_rec);
+}
+
+// split the records into per-process read and write streams.
+static void
+mkstreams(void)
+{
+  streams = xalloc(2 * nrec * sizeof(*streams));
+  for(int i = 0; i < nrec; i++){
+    struct rec *r = &recs[i];
+    struct stream *st;
+
+    if(r->pid > maxpid)
+      maxpid = r->pid;
+    if(r->blockno >= nblocks)
+      nblocks = r->blockno + 1;
+    for(st = streams; st < &streams[nstream]; st++)
+      if(st->pid == r->pid && st->write == r->write)
+        break;
+    if(st == &streams[nstream]){
+      st->pid = r->pid;
+      st->write = r->write;
+      st->recs = xalloc(nrec * sizeof(struct rec*));
+      nstream++;
+    }
+    st->recs[st->n++] = r;
+  }
+}
+
+// when st's next block may be submitted, or -1 if it has none
+// or is waiting for its last read.
+static int64_t
+stream_ready(struct stream *st)
+{
+  struct rec *r;
+
+  if(st->next >= st->n || st->waiting)
+    return -1;
+  r = st->recs[st->next];
+  if(!closed || st->write || st->next == 0)
+    return r->time;
+  return st->ready;
+}
+
+// the closed-loop think time before st's next read: from the
+// last read's completion to the next one's submission in the
+// trace, or the gap between the submissions if that is unknown.
+static uint64
+think(struct stream *st)
+{
+  struct rec *prev = st->recs[st->next - 1], *r;
+
+  if(st->next >= st->n)
+    return 0;
+  r = st->recs[st->next];
+  if(prev->odone && r->time >= prev->odone)
+    return r->time - prev->odone;
+  if(prev->odone)
+    return 0;
+  return r->time - prev->time;
+}
+
+// service time of r if it starts now, and where the head ends up.
+static uint64
+service(struct req *r)
+{
+  uint64 rev = 60ULL * 1000000 / rpm;
+  uint64 blk = rev / spt;
+  uint from = s.head / spt, to = r->blockno / spt;
+  uint dist = from > to ? from - to : to - from;
+  uint ntracks = (nblocks + spt - 1) / spt;
+  uint64 seek = 0, at, target, rot;
+
+  if(dist > 0)
+    seek = seek_min + (seek_max - seek_min) * sqrt((double)dist / ntracks);
+  at = (s.now + seek) % rev;
+  target = (r->blockno % spt) * blk;
+  rot = (target + rev - at) % rev;
+
+  s.seek += r->blockno > s.head ? r->blockno - s.head : s.head - r->blockno;
+  s.nseek++;
+  s.head = r->blockno + r->nseg;
+  return seek + rot + r->nseg * blk;
+}
+
+static void
+submit(struct stream *st)
+{
+  struct sreq *sr = s.free;
+  struct rec *rec = st->recs[st->next++];
+  struct req *r = &sr->r;
+
+  s.free = sr->next;
+  memset(r, 0, sizeof(*r));
+  sr->rec = rec;
+  sr->arrive = s.now;
+  r->seg[0] = (struct buf*)sr;
+  r->nseg = 1;
+  r->cmd = REQ_CMD_RW;
+  r->write = rec->write;
+  r->sync = rec->sync;
+  r->blockno = rec->blockno;
+  r->pid = rec->pid;
+  r->weight = IOW_DEFAULT;
+  r->ioprio = IOPRIO_DEFAULT;
+  r->seq = s.seq++;
+  r->state = REQ_QUEUED;
+  r->time = s.now;
+  if(closed && !st->write)
+    st->waiting = 1;
+  s.outstanding++;
+
+  if(iotune[IOT_MAXSEG] > 1 && s.elv->merge && s.elv->merge(r) != ELV_NO_MERGE){
+    s.merges++;
+    r->nseg = 0;
+    r->state = REQ_FREE;
+    return;
+  }
+  s.queued++;
+  s.elv->add_request(r);
+}
+
+static void
+dispatch(void)
+{
+  struct req *r;
+
+  while(s.ndev < iotune[IOT_DEPTH] && (r = s.elv->dispatch()) != NULL){
+    s.queued--;
+    r->state = REQ_INFLIGHT;
+    r->dtime = s.now;
+    r->elv = s.elv;
+    s.dev[s.ndev++] = r;
+    if(s.ndev == 1)
+      s.busy_until = s.now + service(r);
+  }
+}
+
+static void
+complete(void)
+{
+  struct req *r = s.dev[0];
+
+  memmove(s.dev, s.dev + 1, --s.ndev * sizeof(s.dev[0]));
+  if(s.elv->completed)
+    s.elv->completed(r);
+  s.blocks += r->nseg;
+  for(int i = 0; i < r->nseg; i++){
+    struct sreq *sr = (struct sreq*)r->seg[i];
+    struct rec *rec = sr->rec;
+    uint64 lat = s.now - sr->arrive;
+
+    s.lat[rec->write][s.nlat[rec->write]++] = lat;
+    s.psum[rec->pid] += lat;
+    s.pcnt[rec->pid]++;
+    if(closed && !rec->write){
+      for(struct stream *st = streams; st < &streams[nstream]; st++){
+        if(st->pid == rec->pid && !st->write){
+          st->waiting = 0;
+          st->ready = s.now + think(st);
+        }
+      }
+    }
+    sr->next = s.free;
+    s.free = sr;
+    s.outstanding--;
+  }
+  r->state = REQ_FREE;
+  if(s.ndev > 0)
+    s.busy_until = s.now + service(s.dev[0]);
+}
+
+static uint64
+pct(uint64 *v, int n, int p)
+{
+  if(n == 0)
+    return 0;
+  return v[(uint64)n * p / 100 < n ? (uint64)n * p / 100 : n - 1];
+}
+
+static void
+run(struct elevator_ops *elv, int *tune)
+{
+  static struct sreq pool[NREQ];
+  int done = 0;
+
+  memset(&s, 0, sizeof(s));
+  memcpy(iotune, tune, NIOT * sizeof(int));
+  for(int i = 0; i < NREQ; i++){
+    pool[i].next = s.free;
+    s.free = &pool[i];
+  }
+  for(int w = 0; w < 2; w++)
+    s.lat[w] = xalloc(nrec * sizeof(uint64));
+  s.psum = xalloc((maxpid + 1) * sizeof(double));
+  s.pcnt = xalloc((maxpid + 1) * sizeof(int));
+  for(struct stream *st = streams; st < &streams[nstream]; st++){
+    st->next = 0;
+    st->waiting = 0;
+  }
+  s.elv = elv;
+  elv->init();
+
+  for(;;){
+    // submit whatever is due, oldest first, while bufs last.
+    for(;;){
+      struct stream *best = NULL;
+      int64_t t, bt = 0;
+      for(struct stream *st = streams; st < &streams[nstream]; st++)
+        if((t = stream_ready(st)) >= 0 && (uint64)t <= s.now && (best == NULL || t < bt)){
+          best = st;
+          bt = t;
+        }
+      if(best == NULL || s.outstanding == NREQ)
+        break;
+      submit(best);
+    }
+    dispatch();
+
+    // advance to the next arrival, completion or timer.
+    uint64 next = 0;
+    int any = 0;
+    if(s.outstanding < NREQ){
+      for(struct stream *st = streams; st < &streams[nstream]; st++){
+        int64_t t = stream_ready(st);
+        if(t >= 0 && (!any || (uint64)t < next)){
+          next = t;
+          any = 1;
+        }
+      }
+    }
+    if(s.ndev > 0 && (!any || s.busy_until < next)){
+      next = s.busy_until;
+      any = 1;
+    }
+    if(s.timer != 0 && (!any || s.timer < next)){
+      next = s.timer;
+      any = 1;
+    }
+    if(!any){
+      if(s.outstanding > 0)
+        die("stuck: requests queued with nothing to dispatch them");
+      break;
+    }
+    if(next > s.now)
+      s.now = next;
+    if(s.ndev > 0 && s.now >= s.busy_until){
+      complete();
+      done++;
+    }
+    if(s.timer != 0 && s.now >= s.timer)
+      s.timer = 0;
+  }
+
+  // report
+  double jn = 0, js = 0, jq = 0;
+  for(int p = 0; p <= maxpid; p++){
+    if(s.pcnt[p] == 0)
+      continue;
+    double x = s.psum[p] / s.pcnt[p];
+    jn++;
+    js += x;
+    jq += x * x;
+  }
+  for(int w = 0; w < 2; w++)
+    qsort(s.lat[w], s.nlat[w], sizeof(uint64), cmp_u64);
+  printf("%-9s %6d %6d %9.1f %7.0f  %6.1f %6.1f %6.1f  %6.1f %6.1f  %6.1f  %5.3f\n",
+         elv->name, done, s.merges, s.now / 1000.0,
+         s.now ? s.blocks * 1e6 / s.now : 0.0,
+         pct(s.lat[0], s.nlat[0], 50) / 1000.0, pct(s.lat[0], s.nlat[0], 95) / 1000.0,
+         pct(s.lat[0], s.nlat[0], 99) / 1000.0,
+         pct(s.lat[1], s.nlat[1], 50) / 1000.0, pct(s.lat[1], s.nlat[1], 99) / 1000.0,
+         s.nseek ? (double)s.seek / s.nseek : 0.0,
+         jq > 0 ? js * js / (jn * jq) : 1.0);
+  for(int w = 0; w < 2; w++)
+    free(s.lat[w]);
+  free(s.psum);
+  free(s.pcnt);
+}
+
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: elvsim [-e elevator] [-T param=value]... [-c] [-x scale]\n"
+                  "              [-r rpm] [-s blocks/track] [-m seek_min_us] [-M seek_max_us]\n"
+                  "              (trace | -g)\n"
+                  "the device queue depth is 1 unless -T depth=N is given\n");
+  exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int tune[NIOT], gen = 0, c, nreads = 0;
+  char *only = NULL;
+
+  memcpy(tune, iotune, sizeof(tune));
+  tune[IOT_DEPTH] = 1;   // the elevator, not the in-order disk, picks the order
+  while((c = getopt(argc, argv, "e:T:cx:r:s:m:M:g")) != -1){
+    switch(c){
+    case 'e':
+      only = optarg;
+      break;
+    case 'T': {
+      char *eq = strchr(optarg, '=');
+      int i, n = sizeof(params) / sizeof(params[0]);
+      if(eq == NULL)
+        usage();
+      *eq = 0;
+      for(i = 0; i < n && strcmp(params[i].name, optarg) != 0; i++)
+        ;
+      if(i == n || !iotune_ok(params[i].param, atoi(eq + 1)))
+        die("bad -T param or value");
+      tune[params[i].param] = atoi(eq + 1);
+      break;
+    }
+    case 'c': closed = 1; break;
+    case 'x': scale = atof(optarg); break;
+    case 'r': rpm = atoi(optarg); break;
+    case 's': spt = atoi(optarg); break;
+    case 'm': seek_min = atoi(optarg); break;
+    case 'M': seek_max = atoi(optarg); break;
+    case 'g': gen = 1; break;
+    default: usage();
+    }
+  }
+  if(rpm <= 0 || spt <= 0 || seek_min < 0 || seek_max < seek_min || scale <= 0)
+    usage();
+
+  if(gen){
+    if(optind != argc)
+      usage();
+    generate();
+  } else {
+    FILE *f;
+    if(optind != argc - 1)
+      usage();
+    if((f = fopen(argv[optind], "r")) == NULL)
+      die("cannot open trace");
+    load(f);
+    fclose(f);
+  }
+  mkstreams();
+  for(int i = 0; i < nrec; i++)
+    nreads += !recs[i].write;
+
+  printf("workload: %d reads, %d writes, %s loop\n", nreads, nrec - nreads,
+         closed ? "closed" : "open");
+  printf("disk: %u blocks, %d per track, %d rpm, seek %d..%d us, queue depth %d\n\n",
+         nblocks, spt, rpm, seek_min, seek_max, tune[IOT_DEPTH]);
+  printf("%-9s %6s %6s %9s %7s  %-20s  %-13s  %6s  %5s\n", "elevator", "reqs", "merged",
+         "time(ms)", "blk/s", "read p50/95/99 (ms)", "write p50/99", "seek", "fair");
+  for(int i = 0; i < sizeof(elevators) / sizeof(elevators[0]); i++)
+    if(only == NULL || strcmp(only, elevators[i]->name) == 0 || strcmp(only, names[i]) == 0)
+      run(elevators[i], tune);
+  return 0;
+}
@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+#
+# parse the output of xv6's blktrace (user/blktrace.c), e.g. a
+# saved console log of "make qemu", into:
+#
+#   a summary of the events and of the seek distances between
+#   consecutive dispatches;
+#   with -t FILE, a per-request timeline as CSV: when each
+#   request was queued, dispatched and completed;
+#   with -p PREFIX, PREFIX-seek.png and PREFIX-timeline.png
+#   (needs matplotlib).
+#
+# usage: blkparse.py [-t timeline.csv] [-p prefix] [log]
+#
+
+import argparse
+import collections
+import re
+import sys
+
+# bt cpu time pid action rwbs block count sched
+LINE = re.compile(r"bt (\d+) (\d+) (\d+) ([A-Z]) ([A-Z]+) (\d+) (\d+) (\S+)")
+
+Event = collections.namedtuple("Event", "cpu time pid action rwbs block count sched")
+
+
+def parse(f):
+    events = []
+    for line in f:
+        m = LINE.search(line)   # console output may be interleaved
+        if m is None:
+            continue
+        cpu, time, pid, action, rwbs, block, count, sched = m.groups()
+        events.append(Event(int(cpu), int(time), int(pid), action, rwbs,
+                            int(block), int(count), sched))
+    # each hart's ring is drained in turn; put them back in time order.
+    events.sort(key=lambda e: e.time)
+    return events
+
+
+def direction(rwbs):
+    return rwbs.rstrip("S")
+
+
+def timeline(events):
+    """match each dispatch to the submissions it carries and to
+    its completion. returns dicts with queue, dispatch and
+    complete times, in order of dispatch."""
+    queued = collections.defaultdict(list)     # (block, dir) -> [Q events]
+    inflight = collections.defaultdict(list)   # (block, count, rwbs) -> [req]
+    reqs = []
+
+    for e in events:
+        if e.action == "Q":
+            queued[(e.block, direction(e.rwbs))].append(e)
+        elif e.action == "R":
+            pass   # still queued, the Q stands
+        elif e.action == "D":
+            d = direction(e.rwbs)
+            members = []
+            for b in range(e.block, e.block + max(e.count, 1)):
+                if queued[(b, d)]:
+                    members.append(queued[(b, d)].pop(0))
+            q = min((m.time for m in members), default=e.time)
+            pid = members[0].pid if members else e.pid
+            r = {"block": e.block, "count": e.count, "rwbs": e.rwbs, "pid": pid,
+                 "sched": e.sched, "queue": q, "dispatch": e.time,
+                 "complete": None, "merged": max(len(members) - 1, 0)}
+            inflight[(e.block, e.count, e.rwbs)].append(r)
+            reqs.append(r)
+        elif e.action == "C":
+            key = (e.block, e.count, e.rwbs)
+            if inflight[key]:
+                inflight[key].pop(0)["complete"] = e.time
+    return reqs
+
+
+def log2_bucket(x):
+    return x.bit_length()
+
+
+def summary(events, reqs, out):
+    counts = collections.Counter(e.action for e in events)
+    lost = sum(e.count for e in events if e.action == "X")
+    out.write("events: %d (%s)\n" % (len(events), " ".join(
+        "%s=%d" % (a, counts[a]) for a in sorted(counts))))
+    if lost:
+        out.write("lost: %d events; the timeline has gaps\n" % lost)
+
+    seeks = seek_distances(events)
+    if seeks:
+        out.write("seeks: %d, mean %.1f blocks, max %d\n" % (
+            len(seeks), sum(seeks) / len(seeks), max(seeks)))
+        hist = collections.Counter(log2_bucket(s) for s in seeks)
+        for b in sorted(hist):
+            lo = 0 if b == 0 else 1 << (b - 1)
+            out.write("  %8d+ %6d\n" % (lo, hist[b]))
+
+    done = [r for r in reqs if r["complete"] is not None]
+    for d in sorted(set(direction(r["rwbs"]) for r in done)):
+        rs = [r for r in done if direction(r["rwbs"]) == d]
+        wait = sorted(r["dispatch"] - r["queue"] for r in rs)
+        svc = sorted(r["complete"] - r["dispatch"] for r in rs)
+        out.write("%-2s %6d requests  wait p50 %d p99 %d us  service p50 %d p99 %d us\n" % (
+            d, len(rs), pct(wait, 50), pct(wait, 99), pct(svc, 50), pct(svc, 99)))
+
+
+def pct(xs, p):
+    return xs[min(len(xs) - 1, len(xs) * p // 100)] if xs else 0
+
+
+def seek_distances(events):
+    """blocks between the end of each dispatched request and the
+    start of the next, in dispatch order."""
+    seeks, head = [], None
+    for e in events:
+        if e.action != "D" or e.count == 0:
+            continue   # flushes move nothing
+        if head is not None:
+            seeks.append(abs(e.block - head))
+        head = e.block + e.count
+    return seeks
+
+
+def write_timeline(reqs, path):
+    with open(path, "w") as f:
+        f.write("block,count,rwbs,pid,sched,merged,queue_us,dispatch_us,complete_us,wait_us,service_us\n")
+        for r in reqs:
+            c = r["complete"]
+            f.write("%d,%d,%s,%d,%s,%d,%d,%d,%s,%d,%s\n" % (
+                r["block"], r["count"], r["rwbs"], r["pid"], r["sched"], r["merged"],
+                r["queue"], r["dispatch"], "" if c is None else c,
+                r["dispatch"] - r["queue"], "" if c is None else c - r["dispatch"]))
+
+
+def plot(events, reqs, prefix):
+    try:
+        import matplotlib
+        matplotlib.use("Agg")
+        import matplotlib.pyplot as plt
+    except ImportError:
+        sys.exit("blkparse: -p needs matplotlib")
+
+    ds = [e for e in events if e.action == "D" and e.count > 0]
+    seeks = seek_distances(events)
+    fig, (a, b) = plt.subplots(2, 1, figsize=(10, 8))
+    a.scatter([e.time / 1000 for e in ds], [e.block for e in ds], s=4,
+              c=["tab:red" if direction(e.rwbs).startswith("W") else "tab:blue" for e in ds])
+    a.set_xlabel("ms")
+    a.set_ylabel("block dispatched")
+    a.set_title("head position (blue reads, red writes)")
+    b.plot(seeks, linewidth=0.5)
+    b.set_xlabel("dispatch")
+    b.set_ylabel("seek distance, blocks")
+    fig.tight_layout()
+    fig.savefig(prefix + "-seek.png")
+
+    done = [r for r in reqs if r["complete"] is not None]
+    fig, ax = plt.subplots(figsize=(10, max(4, len(done) * 0.05)))
+    for i, r in enumerate(done):
+        ax.hlines(i, r["queue"] / 1000, r["dispatch"] / 1000, colors="lightgray")
+        ax.hlines(i, r["dispatch"] / 1000, r["complete"] / 1000, linewidth=2,
+                  colors="tab:red" if direction(r["rwbs"]).startswith("W") else "tab:blue")
+    ax.set_xlabel("ms")
+    ax.set_ylabel("request, in dispatch order")
+    ax.set_title("queued (gray) and on the device")
+    fig.tight_layout()
+    fig.savefig(prefix + "-timeline.png")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="parse xv6 blktrace output")
+    ap.add_argument("log", nargs="?", help="console log; default stdin")
+    ap.add_argument("-t", "--timeline", metavar="CSV", help="write per-request timeline")
+    ap.add_argument("-p", "--plot", metavar="PREFIX", help="write PREFIX-seek.png and PREFIX-timeline.png")
+    args = ap.parse_args()
+
+    f = open(args.log, errors="replace") if args.log else sys.stdin
+    events = parse(f)
+    if not events:
+        sys.exit("blkparse: no blktrace events found")
+    reqs = timeline(events)
+    summary(events, reqs, sys.stdout)
+    if args.timeline:
+        write_timeline(reqs, args.timeline)
+    if args.plot:
+        plot(events, reqs, args.plot)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,39 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/iosched.h"
+
+char *classes[] = {
+	[IOPRIO_CLASS_RT] "rt",
+	[IOPRIO_CLASS_BE] "be",
+	[IOPRIO_CLASS_IDLE] "idle",
+};
+
+//以给定的IO优先级运行命令，或查看某进程的IO优先级
+int main(int argc, char *argv[]){
+	if(argc==3 && strcmp(argv[1], "-p")==0){
+		int prio = ioprio_get(atoi(argv[2]));
+		if(prio < 0){
+			printf("IO_prio: no process %s\n", argv[2]);
+			exit(1);
+		}
+		printf("%s %d\n", classes[IOPRIO_PRIO_CLASS(prio)], IOPRIO_PRIO_LEVEL(prio));
+		exit(0);
+	}
+	if(argc<4){
+		printf("Usage: IO_prio rt|be|idle level command [args...]\n");
+		printf("       IO_prio -p pid\n");
+		exit(1);
+	}
+	int class = 0;
+	for(int i=IOPRIO_CLASS_RT;i<=IOPRIO_CLASS_IDLE;i++)
+		if(strcmp(argv[1], classes[i])==0)
+			class = i;
+	if(class==0 || ioprio_set(0, IOPRIO_PRIO_VALUE(class, atoi(argv[2]))) < 0){
+		printf("IO_prio: bad class or level (0..%d)\n", IOPRIO_NLEVEL-1);
+		exit(1);
+	}
+	exec(argv[3], argv+3);
+	printf("IO_prio: exec %s failed\n", argv[3]);
+	exit(1);
+}
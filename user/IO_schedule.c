@@ -2,36 +2,34 @@
 #include "kernel/stat.h"
 #include "user/user.h"
 #include "kernel/fcntl.h"
+#include "kernel/iosched.h"
+
+char *names[NIOSCHED] = IOSCHED_NAMES;
+char *desc[NIOSCHED] = {
+	[IOSCHED_NOOP] "NOOP",
+	[IOSCHED_CFQ] "CFQ",
+	[IOSCHED_SSTF] "SSTF(Shortest Seek Time First)",
+	[IOSCHED_DEADLINE] "Deadline",
+	[IOSCHED_CSCAN] "Cycle-SCAN",
+	[IOSCHED_AS] "Anticipatory",
+	[IOSCHED_BFQ] "BFQ",
+	[IOSCHED_KYBER] "Kyber",
+};
 
 int main(int argc, char *argv[]){
-	if(argc!=2)
+	if(argc!=2){
 		printf("Usage: IO_schedule\n need a parameter.\n");
-	else{
-		char* input=argv[1];
-		char* noop="noop";
-		char* sstf="sstf";
-		char* ddl="ddl";
-		char* cfq="cfq";
-		char* cscan="cscan";
-		if (strcmp(input, noop) == 0){
-			IO_schedule(0);
-			printf("IO scheduling algorithm switch to NOOP.\n");
-		}else if(strcmp(input, cfq) == 0){
-			IO_schedule(1);
-			printf("IO scheduling algorithm switch to CFQ.\n");
-		}else if(strcmp(input, sstf) == 0){
-			IO_schedule(2);
-			printf("IO scheduling algorithm switch to SSTF(Shortest Seek Time First).\n");
-		}else if(strcmp(input, ddl) == 0){
-			IO_schedule(3);
-			printf("IO scheduling algorithm switch to Deadline.\n");
-		}else if(strcmp(input, cscan) == 0){
-			IO_schedule(4);
-			printf("IO scheduling algorithm switch to Cycle-SCAN.\n");
-		}else{
-			printf("Usage: elevator. invalid parameter.\n");
-		}
-		
+		exit(0);
+	}
+	for(int i=0;i<NIOSCHED;i++){
+		if(strcmp(argv[1], names[i]) != 0)
+			continue;
+		if(IO_schedule(i) < 0)
+			printf("IO scheduling algorithm %s is not available.\n", argv[1]);
+		else
+			printf("IO scheduling algorithm switch to %s.\n", desc[i]);
+		exit(0);
 	}
+	printf("Usage: elevator. invalid parameter.\n");
 	exit(0);
 }
@@ -0,0 +1,52 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/iosched.h"
+
+struct {
+	char *name;
+	int param;
+} params[] = {
+	{ "depth", IOT_DEPTH },
+	{ "cfq_quantum", IOT_CFQ_QUANTUM },
+	{ "cfq_budget", IOT_CFQ_BUDGET },
+	{ "maxseg", IOT_MAXSEG },
+	{ "read_expire", IOT_DL_READ_EXPIRE },
+	{ "write_expire", IOT_DL_WRITE_EXPIRE },
+	{ "fifo_batch", IOT_DL_FIFO_BATCH },
+	{ "writes_starved", IOT_DL_WRITES_STARVED },
+	{ "antic", IOT_AS_ANTIC },
+	{ "bfq_budget", IOT_BFQ_BUDGET },
+	{ "bfq_timeout", IOT_BFQ_TIMEOUT },
+	{ "idle_grace", IOT_IDLE_GRACE },
+	{ "kyber_read_lat", IOT_KY_READ_LAT },
+	{ "kyber_sync_lat", IOT_KY_SYNC_LAT },
+	{ "kyber_write_lat", IOT_KY_WRITE_LAT },
+	{ "irq_batch", IOT_IRQ_BATCH },
+	{ "poll", IOT_POLL },
+	{ "trace", IOT_TRACE },
+	{ "bfq_idle", IOT_BFQ_IDLE },
+};
+
+int main(int argc, char *argv[]){
+	if(argc!=2 && argc!=3){
+		printf("Usage: IO_tune param [value]\n");
+		exit(1);
+	}
+	for(int i=0;i<sizeof(params)/sizeof(params[0]);i++){
+		if(strcmp(argv[1], params[i].name) != 0)
+			continue;
+		int old = IO_tune(params[i].param, argc==3 ? atoi(argv[2]) : -1);
+		if(old < 0){
+			printf("IO_tune: bad value for %s\n", argv[1]);
+			exit(1);
+		}
+		if(argc==3)
+			printf("%s: %d -> %s\n", argv[1], old, argv[2]);
+		else
+			printf("%s: %d\n", argv[1], old);
+		exit(0);
+	}
+	printf("IO_tune: unknown param %s\n", argv[1]);
+	exit(1);
+}
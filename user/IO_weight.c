@@ -0,0 +1,19 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/iosched.h"
+
+//以给定的IO权重运行命令
+int main(int argc, char *argv[]){
+	if(argc<3){
+		printf("Usage: IO_weight weight command [args...]\n");
+		exit(1);
+	}
+	if(IO_weight(atoi(argv[1])) < 0){
+		printf("IO_weight: weight must be %d..%d\n", IOW_MIN, IOW_MAX);
+		exit(1);
+	}
+	exec(argv[2], argv+2);
+	printf("IO_weight: exec %s failed\n", argv[2]);
+	exit(1);
+}
@@ -2,6 +2,7 @@
 #include "kernel/stat.h"
 #include "user/user.h"
 #include "kernel/fcntl.h"
+#include "kernel/iosched.h"
 
 #define BLOCK_P_FILE 5
 #define PROC_NUM  16
@@ -113,6 +114,12 @@ void multi_proc_seg_tree(int L,int R,int nowpid){
         write(Result_Fd, result_str, len);
         
         printf("    !!! proc%d finish working  time:%d\n", nowpid ,tmp_tick);
+
+        //每个进程的IO服务时间，用于检查公平性
+        struct iopstat st;
+        IO_pstat(&st);
+        printf("    !!! proc%d io requests:%d  wait:%dms  service:%dms\n", nowpid,
+               (int)st.nreq, (int)(st.wait/1000), (int)(st.service/1000));
         exit(0);
     }
     if(L<R){
@@ -0,0 +1,82 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/fcntl.h"
+#include "kernel/iosched.h"
+
+// 读吞吐量随并发进程数（1~8）的变化。
+// 每个进程反复顺序读取自己的文件；文件大于缓存区（NBUF=30块），
+// 所以每次读都会提交到块层。
+// 注意：测的是端到端的读吞吐量，上限是唯一的一块（模拟）磁盘，
+// 并不单独测量提交路径（rw_submit/blk_run）在多核上的开销；
+// 提交路径若成为瓶颈，只会表现为吞吐量不随进程数增长；
+// blocks/req 是每个磁盘请求平均合并的块数。用 CPUS=8 运行。
+
+#define MAX_PROC  8
+#define BLOCKS    40    //每个文件的块数，大于NBUF
+#define ROUNDS    20    //每个进程读文件的遍数
+
+char buf[1024];
+
+void fname(char *name, int i){
+    strcpy(name, "f_IOtest4_0");
+    name[10] = '0' + i;
+}
+
+void create_file(int i){
+    char name[16];
+    fname(name, i);
+    int fd = open(name, O_CREATE|O_WRONLY);
+    for(int b = 0; b < BLOCKS; b++)
+        write(fd, buf, sizeof(buf));
+    close(fd);
+}
+
+void reader(int i){
+    char name[16];
+    fname(name, i);
+    for(int r = 0; r < ROUNDS; r++){
+        int fd = open(name, O_RDONLY);
+        while(read(fd, buf, sizeof(buf)) > 0)
+            ;
+        close(fd);
+    }
+    exit(0);
+}
+
+int main(int argc, char *argv[]){
+    int max = argc > 1 ? atoi(argv[1]) : MAX_PROC;
+    struct iostats before, after;
+
+    if(max < 1 || max > MAX_PROC){
+        printf("Usage: IOtest4 [1..%d]\n", MAX_PROC);
+        exit(1);
+    }
+    for(int i = 0; i < max; i++)
+        create_file(i);
+
+    printf("procs\tticks\tblocks/s\trequests\tblocks/req\n");
+    for(int n = 1; n <= max; n++){
+        IO_stats(&before);
+        int begin = uptime();   //uptime单位为0.1s
+        for(int i = 0; i < n; i++)
+            if(fork() == 0)
+                reader(i);
+        for(int i = 0; i < n; i++)
+            wait(0);
+        int ticks = uptime() - begin;
+        IO_stats(&after);
+        int blocks = n * ROUNDS * BLOCKS;
+        int reqs = after.ios[0] - before.ios[0];
+        int rblocks = after.blocks[0] - before.blocks[0];
+        printf("%d\t%d\t%d\t\t%d\t\t%d.%d\n", n, ticks, ticks ? blocks * 10 / ticks : 0,
+               reqs, reqs ? rblocks / reqs : 0, reqs ? rblocks * 10 / reqs % 10 : 0);
+    }
+
+    for(int i = 0; i < max; i++){
+        char name[16];
+        fname(name, i);
+        unlink(name);
+    }
+    exit(0);
+}
@@ -0,0 +1,64 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/iosched.h"
+
+//跟踪一个命令运行期间的块层事件，每个事件打印一行：
+//  bt 核 时间(us) pid 事件 rwbs 块号 块数 调度算法
+//用法: blktrace 命令 [参数...]
+//控制台输出可由主机上的 tools/blkparse.py 解析
+
+#define BATCH 32
+
+char *names[NIOSCHED] = IOSCHED_NAMES;
+struct blktrace ev[BATCH];
+
+//打印已记录的事件，返回条数
+int dump(void){
+	int n, total = 0;
+
+	while((n = IO_trace(ev, BATCH)) > 0){
+		for(int i=0;i<n;i++){
+			struct blktrace *e = &ev[i];
+			char *sched = (uchar)e->sched < NIOSCHED ? names[(uchar)e->sched] : "?";
+			printf("bt %d %l %d %c %s %d %d %s\n", e->cpu, e->time, e->pid, e->action,
+			       e->rwbs, e->blockno, e->count, sched);
+		}
+		total += n;
+	}
+	return total;
+}
+
+int main(int argc, char *argv[]){
+	int drainer, pid;
+
+	if(argc < 2){
+		printf("Usage: blktrace command [args...]\n");
+		exit(1);
+	}
+	if(IO_tune(IOT_TRACE, 1) < 0){
+		printf("blktrace: failed\n");
+		exit(1);
+	}
+	while(IO_trace(ev, BATCH) > 0)	//丢弃之前残留的事件
+		;
+
+	//子进程持续读出事件，直到跟踪关闭
+	if((drainer = fork()) == 0){
+		while(IO_tune(IOT_TRACE, -1) == 1)
+			if(dump() == 0)
+				sleep(1);
+		dump();
+		exit(0);
+	}
+	if((pid = fork()) == 0){
+		exec(argv[1], argv + 1);
+		printf("blktrace: exec %s failed\n", argv[1]);
+		exit(1);
+	}
+	while(pid > 0 && wait(0) != pid)
+		;
+	IO_tune(IOT_TRACE, 0);
+	wait(0);
+	exit(0);
+}
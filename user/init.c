@@ -23,6 +23,10 @@ main(void)
   dup(0);  // stdout 文件描述符1为控制台
   dup(0);  // stderr 文件描述符2为控制台
 
+  struct stat st;
+  if(stat("diskstats", &st) < 0)  //磁盘统计设备
+    mknod("diskstats", DISKSTATS, 0);
+
   for(;;){  //shell循环
     printf("init: starting sh\n");
     pid = fork();
@@ -0,0 +1,63 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/iosched.h"
+
+//打印各调度算法下请求的排队与服务延迟分位数（微秒）
+//用法: iolat [调度算法]，默认打印所有有记录的算法
+
+char *names[NIOSCHED] = IOSCHED_NAMES;
+
+//分位数所在桶的上界，permille为千分位
+int percentile(uint64 *b, int permille){
+	uint64 total = 0, sum = 0;
+	for(int i=0;i<NHIST;i++)
+		total += b[i];
+	for(int i=0;i<NHIST;i++){
+		sum += b[i];
+		if(sum * 1000 >= total * permille)
+			return 1 << (i + 1);
+	}
+	return 1 << NHIST;
+}
+
+uint64 count(uint64 *b){
+	uint64 n = 0;
+	for(int i=0;i<NHIST;i++)
+		n += b[i];
+	return n;
+}
+
+void show(int type){
+	struct iohist h;
+	char *dir[2] = { "read", "write" };
+
+	if(IO_hist(type, &h) < 0){
+		printf("iolat: failed\n");
+		exit(1);
+	}
+	for(int d=0;d<2;d++){
+		if(count(h.device[d]) == 0)
+			continue;
+		printf("%s\t%s\t%d\tqueue <%d <%d <%d\tdevice <%d <%d <%d\n",
+			names[type], dir[d], (int)count(h.device[d]),
+			percentile(h.queue[d], 500), percentile(h.queue[d], 990), percentile(h.queue[d], 999),
+			percentile(h.device[d], 500), percentile(h.device[d], 990), percentile(h.device[d], 999));
+	}
+}
+
+int main(int argc, char *argv[]){
+	printf("sched\tdir\tios\tp50/p99/p99.9 us\n");
+	if(argc > 1){
+		for(int i=0;i<NIOSCHED;i++)
+			if(strcmp(argv[1], names[i]) == 0){
+				show(i);
+				exit(0);
+			}
+		printf("iolat: unknown scheduler %s\n", argv[1]);
+		exit(1);
+	}
+	for(int i=0;i<NIOSCHED;i++)
+		show(i);
+	exit(0);
+}
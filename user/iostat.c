@@ -0,0 +1,29 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/iosched.h"
+
+//打印磁盘请求与合并统计
+int main(int argc, char *argv[]){
+	struct iostats st;
+	char *dir[2] = { "read", "write" };
+
+	if(IO_stats(&st) < 0){
+		printf("iostat: failed\n");
+		exit(1);
+	}
+	printf("       ios     blocks  merges\n");
+	for(int i=0;i<2;i++)
+		printf("%s:\t%d\t%d\t%d\n", dir[i], (int)st.ios[i], (int)st.blocks[i], (int)st.merges[i]);
+	printf("front merges: %d\n", (int)st.frontmerges);
+	printf("notifies: %d (skipped %d)\n", (int)st.notifies, (int)st.nonotifies);
+	printf("interrupts: %d\n", (int)st.interrupts);
+	printf("completed by interrupt: %d, by polling: %d\n", (int)st.intrdone, (int)st.polldone);
+	printf("request objects exhausted: %d\n", (int)st.exhausted);
+	printf("cache flushes: %d\n", (int)st.flushes);
+	printf("discards: %d (%d blocks)\n", (int)st.discards, (int)st.discarded);
+	printf("write zeroes: %d (%d blocks)\n", (int)st.wzeroes, (int)st.zeroed);
+	printf("in progress: %d, busy %d ms, weighted %d ms\n", (int)st.inprogress,
+	       (int)(st.busy / 1000), (int)(st.weighted / 1000));
+	exit(0);
+}
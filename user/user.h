@@ -1,5 +1,9 @@
 struct stat;
 struct rtcdate;
+struct blktrace;
+struct iohist;
+struct iopstat;
+struct iostats;
 
 // system calls
 int fork(void);
@@ -25,6 +29,14 @@ int sleep(int);
 int uptime(void);
 int sysinfo(int *);//调用系统信息
 int IO_schedule(int);  //IO调度
+int IO_tune(int, int);  //IO调度参数
+int IO_pstat(struct iopstat*);  //本进程的IO统计
+int IO_stats(struct iostats*);  //磁盘请求与合并统计
+int IO_hist(int, struct iohist*);  //各调度算法的请求延迟分布
+int IO_trace(struct blktrace*, int);  //读取块层事件跟踪
+int IO_weight(int);  //本进程的IO权重
+int ioprio_set(int, int);  //IO优先级
+int ioprio_get(int);
 
 // ulib.c
 int stat(const char*, struct stat*);
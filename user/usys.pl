@@ -38,3 +38,11 @@ entry("sleep");
 entry("uptime");
 entry("sysinfo");
 entry("IO_schedule");
+entry("IO_tune");
+entry("IO_pstat");
+entry("IO_stats");
+entry("IO_weight");
+entry("ioprio_set");
+entry("ioprio_get");
+entry("IO_hist");
+entry("IO_trace");